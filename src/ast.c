@@ -185,6 +185,8 @@ static ast_record_proto_t* ast_parser_decl_record(ast_parser_t* ast_parser, uint
 	new_rec->index_offset = 0;
 	new_rec->child_record_count = 0;
 	new_rec->linked = 0;
+	new_rec->do_gc = 0;
+	new_rec->is_used = 0;
 	ast_parser->ast->record_protos[ast_parser->ast->record_count++] = new_rec;
 	return new_rec;
 }
@@ -268,13 +270,38 @@ static int code_paths_return(ast_code_block_t code_block, int is_while_true, int
 
 static int substitute_value_types(ast_parser_t* ast_parser, ast_value_t input_val, typecheck_type_t* input_typeargs, ast_value_t* output_val) {
 	*output_val = input_val;
+	output_val->id = ast_parser->ast->value_count++; //every copy gets its own id, otherwise every copy would share one eval register
 	TYPE_COPY(&output_val->type, input_val.type);
 	ESCAPE_ON_FAIL(typeargs_substitute(ast_parser->safe_gc, input_typeargs, &output_val->type));
 
 	switch (output_val->value_type)
 	{
 	case AST_VALUE_ALLOC_ARRAY:
+		PANIC_ON_FAIL(output_val->data.alloc_array = safe_malloc(ast_parser->safe_gc, sizeof(ast_alloc_t)), ast_parser, ERROR_MEMORY);
+		*output_val->data.alloc_array = *input_val.data.alloc_array;
 		output_val->data.alloc_array->elem_type = output_val->type.sub_types;
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.alloc_array->size, input_typeargs, &output_val->data.alloc_array->size));
+		break;
+	case AST_VALUE_GET_INDEX:
+		PANIC_ON_FAIL(output_val->data.get_index = safe_malloc(ast_parser->safe_gc, sizeof(ast_get_index_t)), ast_parser, ERROR_MEMORY);
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.get_index->array, input_typeargs, &output_val->data.get_index->array));
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.get_index->index, input_typeargs, &output_val->data.get_index->index));
+		break;
+	case AST_VALUE_GET_PROP:
+		PANIC_ON_FAIL(output_val->data.get_prop = safe_malloc(ast_parser->safe_gc, sizeof(ast_get_prop_t)), ast_parser, ERROR_MEMORY);
+		output_val->data.get_prop->property = input_val.data.get_prop->property;
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.get_prop->record, input_typeargs, &output_val->data.get_prop->record));
+		break;
+	case AST_VALUE_BINARY_OP:
+		PANIC_ON_FAIL(output_val->data.binary_op = safe_malloc(ast_parser->safe_gc, sizeof(ast_binary_op_t)), ast_parser, ERROR_MEMORY);
+		output_val->data.binary_op->operator = input_val.data.binary_op->operator;
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.binary_op->lhs, input_typeargs, &output_val->data.binary_op->lhs));
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.binary_op->rhs, input_typeargs, &output_val->data.binary_op->rhs));
+		break;
+	case AST_VALUE_UNARY_OP:
+		PANIC_ON_FAIL(output_val->data.unary_op = safe_malloc(ast_parser->safe_gc, sizeof(ast_unary_op_t)), ast_parser, ERROR_MEMORY);
+		*output_val->data.unary_op = *input_val.data.unary_op;
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.unary_op->operand, input_typeargs, &output_val->data.unary_op->operand));
 		break;
 	case AST_VALUE_ARRAY_LITERAL:
 		output_val->data.array_literal.elem_type = output_val->type.sub_types;
@@ -292,6 +319,9 @@ static int substitute_value_types(ast_parser_t* ast_parser, ast_value_t input_va
 	case AST_VALUE_PROC_CALL:
 		PANIC_ON_FAIL(output_val->data.proc_call = safe_malloc(ast_parser->safe_gc, sizeof(ast_call_proc_t)), ast_parser, ERROR_MEMORY);
 		*output_val->data.proc_call = *input_val.data.proc_call;
+		output_val->data.proc_call->id = ast_parser->ast->proc_call_count++;
+		output_val->data.proc_call->typearg_traces = NULL; //postproc gives each call its own traces
+		ESCAPE_ON_FAIL(substitute_value_types(ast_parser, input_val.data.proc_call->procedure, input_typeargs, &output_val->data.proc_call->procedure));
 		PANIC_ON_FAIL(output_val->data.proc_call->typeargs = safe_malloc(ast_parser->safe_gc, input_val.data.proc_call->procedure.type.type_id * sizeof(typecheck_type_t)), ast_parser, ERROR_MEMORY);
 
 		for (uint_fast8_t i = 0; i < input_val.data.proc_call->procedure.type.type_id; i++) {
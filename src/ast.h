@@ -275,6 +275,7 @@ typedef struct ast_record_proto {
 	uint16_t index_offset, default_value_count, child_record_count;
 
 	int typeargs_defined, fully_defined, do_gc, linked;
+	int is_used; //allocated by code that gets compiled, or extended by a record that is
 } ast_record_proto_t;
 
 typedef struct ast_get_prop {
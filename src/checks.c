@@ -0,0 +1,329 @@
+#include "checks.h"
+
+#define REG_EQ(A, B) ((A).reg == (B).reg && (A).offset == (B).offset)
+
+static void kill_reg(range_state_t* state, compiler_reg_t reg) {
+	for (uint_fast8_t i = 0; i < state->fact_count;)
+		if (REG_EQ(state->facts[i].reg, reg) || REG_EQ(state->facts[i].index, reg) || REG_EQ(state->facts[i].array, reg))
+			state->facts[i] = state->facts[--state->fact_count];
+		else
+			i++;
+}
+
+static void add_fact(range_state_t* state, range_fact_t fact) {
+	if (state->fact_count < MAX_RANGE_FACTS)
+		state->facts[state->fact_count++] = fact;
+}
+
+static int has_fact(range_state_t* state, range_fact_t fact) {
+	for (uint_fast8_t i = 0; i < state->fact_count; i++)
+		if (state->facts[i].kind == fact.kind && REG_EQ(state->facts[i].reg, fact.reg) && REG_EQ(state->facts[i].index, fact.index) && REG_EQ(state->facts[i].array, fact.array))
+			return 1;
+	return 0;
+}
+
+static range_fact_t* find_fact(range_state_t* state, uint8_t kind, compiler_reg_t reg) {
+	for (uint_fast8_t i = 0; i < state->fact_count; i++)
+		if (state->facts[i].kind == kind && REG_EQ(state->facts[i].reg, reg))
+			return &state->facts[i];
+	return NULL;
+}
+
+//updates what's known after an instruction executes
+static void range_transfer(range_state_t* state, compiler_ins_t ins) {
+	switch (ins.op_code)
+	{
+	case COMPILER_OP_CODE_LENGTH:
+		kill_reg(state, ins.regs[0]);
+		if (!REG_EQ(ins.regs[0], ins.regs[1]))
+			add_fact(state, (range_fact_t) { .kind = RANGE_FACT_LENGTH, .reg = ins.regs[0], .index = ins.regs[0], .array = ins.regs[1] });
+		return;
+	case COMPILER_OP_CODE_LONG_LESS:
+	case COMPILER_OP_CODE_LONG_MORE: { //i < #a, or #a > i
+		compiler_reg_t index = ins.regs[ins.op_code == COMPILER_OP_CODE_LONG_MORE];
+		range_fact_t* length = find_fact(state, RANGE_FACT_LENGTH, ins.regs[ins.op_code == COMPILER_OP_CODE_LONG_LESS]);
+		range_fact_t less = { .kind = RANGE_FACT_LESS, .reg = ins.regs[2], .index = index };
+		if (length)
+			less.array = length->array;
+		kill_reg(state, ins.regs[2]);
+		if (length && !REG_EQ(index, ins.regs[2]) && !REG_EQ(less.array, ins.regs[2]))
+			add_fact(state, less);
+		return;
+	}
+	case COMPILER_OP_CODE_ABORT:
+	case COMPILER_OP_CODE_POP_ATOM_TYPESIGS:
+	case COMPILER_OP_CODE_JUMP:
+	case COMPILER_OP_CODE_JUMP_CHECK:
+	case COMPILER_OP_CODE_TAIL_CALL:
+	case COMPILER_OP_CODE_RETURN:
+	case COMPILER_OP_CODE_STACK_VALIDATE:
+	case COMPILER_OP_CODE_STORE_ALLOC_I: { //array literals store their elements in order, so they're filled by the store to their last element
+		range_fact_t* filling = find_fact(state, RANGE_FACT_FILLING, ins.regs[0]);
+		if (filling && ins.regs[2].reg + 1 == filling->index.reg)
+			filling->kind = RANGE_FACT_INIT;
+		return;
+	}
+	case COMPILER_OP_CODE_STORE_ALLOC:
+	case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
+	case COMPILER_OP_CODE_STORE_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_CONF_TRACE:
+	case COMPILER_OP_CODE_DYNAMIC_CONF:
+	case COMPILER_OP_CODE_DYNAMIC_CONF_ALL:
+	case COMPILER_OP_CODE_FREE:
+	case COMPILER_OP_CODE_DYNAMIC_FREE:
+	case COMPILER_OP_CODE_RC_RELEASE:
+	case COMPILER_OP_CODE_GC_NEW_FRAME:
+	case COMPILER_OP_CODE_GC_TRACE:
+	case COMPILER_OP_CODE_DYNAMIC_TRACE:
+	case COMPILER_OP_CODE_GC_CLEAN:
+	case COMPILER_OP_CODE_CONFIG_TYPESIG:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DD:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DR:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_RD:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_ARRAY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY_DOWNCAST:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY_DOWNCAST:
+	case COMPILER_OP_CODE_SET_EXTRA_ARGS:
+		return;
+	case COMPILER_OP_CODE_MOVE: {
+		range_fact_t* init = find_fact(state, RANGE_FACT_INIT, ins.regs[1]);
+		range_fact_t copy = init ? *init : (range_fact_t) { 0 };
+		kill_reg(state, ins.regs[0]);
+		if (init)
+			add_fact(state, (range_fact_t) { .kind = RANGE_FACT_INIT, .reg = ins.regs[0], .index = copy.index, .array = ins.regs[0] });
+		return;
+	}
+	case COMPILER_OP_CODE_ALLOC_I:
+	case COMPILER_OP_CODE_ALLOC_I_INIT:
+		kill_reg(state, ins.regs[0]);
+		add_fact(state, (range_fact_t) { .kind = RANGE_FACT_FILLING, .reg = ins.regs[0], .index = ins.regs[1], .array = ins.regs[0] });
+		return;
+	case COMPILER_OP_CODE_SET:
+	case COMPILER_OP_CODE_LABEL:
+	case COMPILER_OP_CODE_ALLOC:
+	case COMPILER_OP_CODE_NOT:
+	case COMPILER_OP_CODE_LONG_NEGATE:
+	case COMPILER_OP_CODE_FLOAT_NEGATE:
+	case COMPILER_OP_CODE_LONG_INCREMENT:
+	case COMPILER_OP_CODE_LONG_DECREMENT:
+	case COMPILER_OP_CODE_FLOAT_INCREMENT:
+	case COMPILER_OP_CODE_FLOAT_DECREMENT:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DD:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DR:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_RD:
+		kill_reg(state, ins.regs[0]);
+		return;
+	case COMPILER_OP_CODE_LOAD_ALLOC_I:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_INIT:
+	case COMPILER_OP_CODE_RUNTIME_TYPECHECK:
+	case COMPILER_OP_CODE_RUNTIME_TYPECAST:
+		kill_reg(state, ins.regs[1]);
+		return;
+	case COMPILER_OP_CODE_LOAD_ALLOC:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT:
+	case COMPILER_OP_CODE_AND:
+	case COMPILER_OP_CODE_OR:
+	case COMPILER_OP_CODE_PTR_EQUAL:
+	case COMPILER_OP_CODE_BOOL_EQUAL:
+	case COMPILER_OP_CODE_CHAR_EQUAL:
+	case COMPILER_OP_CODE_LONG_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_EQUAL:
+	case COMPILER_OP_CODE_LONG_MORE_EQUAL:
+	case COMPILER_OP_CODE_LONG_LESS_EQUAL:
+	case COMPILER_OP_CODE_LONG_ADD:
+	case COMPILER_OP_CODE_LONG_SUBTRACT:
+	case COMPILER_OP_CODE_LONG_MULTIPLY:
+	case COMPILER_OP_CODE_LONG_DIVIDE:
+	case COMPILER_OP_CODE_LONG_DIVIDE_NONZERO:
+	case COMPILER_OP_CODE_LONG_MODULO:
+	case COMPILER_OP_CODE_LONG_EXPONENTIATE:
+	case COMPILER_OP_CODE_FLOAT_MORE:
+	case COMPILER_OP_CODE_FLOAT_LESS:
+	case COMPILER_OP_CODE_FLOAT_MORE_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_LESS_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_ADD:
+	case COMPILER_OP_CODE_FLOAT_SUBTRACT:
+	case COMPILER_OP_CODE_FLOAT_MULTIPLY:
+	case COMPILER_OP_CODE_FLOAT_DIVIDE:
+	case COMPILER_OP_CODE_FLOAT_MODULO:
+	case COMPILER_OP_CODE_FLOAT_EXPONENTIATE:
+		kill_reg(state, ins.regs[2]);
+		return;
+	default:
+		//calls and foreign functions may write to any register, or resize any array
+		state->fact_count = 0;
+		return;
+	}
+}
+
+//merges the facts flowing into a block, keeping only those that hold along every path
+static int range_merge(range_state_t* dest, range_state_t* src) {
+	if (!dest->reached) {
+		*dest = *src;
+		dest->reached = 1;
+		return 1;
+	}
+
+	uint8_t old_count = dest->fact_count;
+	for (uint_fast8_t i = 0; i < dest->fact_count;)
+		if (!has_fact(src, dest->facts[i]))
+			dest->facts[i] = dest->facts[--dest->fact_count];
+		else
+			i++;
+	return dest->fact_count != old_count;
+}
+
+//runs through a block from its leader, optionally dropping the checks it can prove pass; returns whether any successor's facts changed
+static int range_walk_block(compiler_t* compiler, range_state_t* states, uint32_t* leader_ids, uint32_t ip, int elide) {
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	range_state_t state = states[leader_ids[ip]];
+	int changed = 0;
+
+	for (;; ip++) {
+		compiler_ins_t* ins = &instructions[ip];
+		switch (ins->op_code)
+		{
+		case COMPILER_OP_CODE_JUMP:
+			return changed | range_merge(&states[leader_ids[ins->regs[0].reg]], &state);
+		case COMPILER_OP_CODE_JUMP_CHECK: {
+			changed |= range_merge(&states[leader_ids[ins->regs[1].reg]], &state);
+
+			//falling through means the condition held
+			uint8_t fact_count = state.fact_count;
+			for (uint_fast8_t i = 0; i < fact_count; i++)
+				if (state.facts[i].kind == RANGE_FACT_LESS && REG_EQ(state.facts[i].reg, ins->regs[0]))
+					add_fact(&state, (range_fact_t) { .kind = RANGE_FACT_BOUND, .reg = state.facts[i].index, .index = state.facts[i].index, .array = state.facts[i].array });
+			return changed | range_merge(&states[leader_ids[ip + 1]], &state);
+		}
+		case COMPILER_OP_CODE_RETURN:
+		case COMPILER_OP_CODE_TAIL_CALL:
+		case COMPILER_OP_CODE_ABORT:
+			return changed;
+		case COMPILER_OP_CODE_LOAD_ALLOC:
+		case COMPILER_OP_CODE_STORE_ALLOC:
+			if (elide && has_fact(&state, (range_fact_t) { .kind = RANGE_FACT_BOUND, .reg = ins->regs[1], .index = ins->regs[1], .array = ins->regs[0] }))
+				ins->op_code = ins->op_code == COMPILER_OP_CODE_LOAD_ALLOC ? COMPILER_OP_CODE_LOAD_ALLOC_INBOUND : COMPILER_OP_CODE_STORE_ALLOC_INBOUND;
+			if (elide && find_fact(&state, RANGE_FACT_INIT, ins->regs[0])) {
+				if (ins->op_code == COMPILER_OP_CODE_LOAD_ALLOC)
+					ins->op_code = COMPILER_OP_CODE_LOAD_ALLOC_INIT;
+				else if (ins->op_code == COMPILER_OP_CODE_LOAD_ALLOC_INBOUND)
+					ins->op_code = COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT;
+			}
+			break;
+		case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND: {
+			range_fact_t* init = find_fact(&state, RANGE_FACT_INIT, ins->regs[0]);
+			if (elide && init && ins->regs[2].reg < init->index.reg)
+				ins->op_code = COMPILER_OP_CODE_LOAD_ALLOC_I_INIT;
+			break;
+		}
+		}
+
+		range_transfer(&state, *ins);
+		if (ip + 1 == compiler->ins_builder.instruction_count)
+			return changed;
+		if (leader_ids[ip + 1] != UINT32_MAX)
+			return changed | range_merge(&states[leader_ids[ip + 1]], &state);
+	}
+}
+
+int elide_checks(compiler_t* compiler) {
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint32_t count = compiler->ins_builder.instruction_count;
+
+	//divisions by nonzero constants can't fail
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		if (instructions[ip].op_code == COMPILER_OP_CODE_LONG_DIVIDE && !instructions[ip].regs[1].offset && instructions[ip].regs[1].reg < compiler->ast->constant_count && compiler->target_machine->stack[instructions[ip].regs[1].reg].long_int)
+			instructions[ip].op_code = COMPILER_OP_CODE_LONG_DIVIDE_NONZERO;
+
+	//blocks start at the program's entry, proc bodies, jump targets, and wherever control can't fall through from the previous instruction
+	uint32_t* leader_ids;
+	ESCAPE_ON_FAIL(leader_ids = safe_malloc(compiler->safe_gc, count * sizeof(uint32_t)));
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		leader_ids[ip] = UINT32_MAX;
+
+#define MARK_LEADER(IP) if ((IP) < count) { leader_ids[IP] = 0; }
+	MARK_LEADER(0);
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		switch (instructions[ip].op_code) {
+		case COMPILER_OP_CODE_JUMP:
+			MARK_LEADER(instructions[ip].regs[0].reg);
+			MARK_LEADER(ip + 1);
+			break;
+		case COMPILER_OP_CODE_JUMP_CHECK:
+		case COMPILER_OP_CODE_LABEL:
+			MARK_LEADER(instructions[ip].regs[1].reg);
+			MARK_LEADER(ip + 1);
+			break;
+		case COMPILER_OP_CODE_CALL:
+		case COMPILER_OP_CODE_RETURN:
+		case COMPILER_OP_CODE_TAIL_CALL:
+		case COMPILER_OP_CODE_ABORT:
+			MARK_LEADER(ip + 1);
+			break;
+		}
+#undef MARK_LEADER
+
+	uint32_t leader_count = 0;
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		if (leader_ids[ip] != UINT32_MAX)
+			leader_ids[ip] = leader_count++;
+
+	range_state_t* states;
+	ESCAPE_ON_FAIL(states = safe_calloc(compiler->safe_gc, leader_count, sizeof(range_state_t)));
+
+	//nothing is known when the program starts, or when a proc is called
+	states[leader_ids[0]].reached = 1;
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		if (instructions[ip].op_code == COMPILER_OP_CODE_LABEL)
+			states[leader_ids[instructions[ip].regs[1].reg]].reached = 1;
+
+	//facts only ever get dropped, so this reaches a fixed point
+	int changed;
+	do {
+		changed = 0;
+		for (uint_fast32_t ip = 0; ip < count; ip++)
+			if (leader_ids[ip] != UINT32_MAX && states[leader_ids[ip]].reached)
+				changed |= range_walk_block(compiler, states, leader_ids, ip, 0);
+	} while (changed);
+
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		if (leader_ids[ip] != UINT32_MAX && states[leader_ids[ip]].reached)
+			range_walk_block(compiler, states, leader_ids, ip, 1);
+
+	safe_free(compiler->safe_gc, leader_ids);
+	safe_free(compiler->safe_gc, states);
+	return 1;
+}
+
+//release builds that have already been validated drop every remaining bounds, init, and zero check
+void drop_checks(compiler_t* compiler) {
+	for (uint_fast32_t ip = 0; ip < compiler->ins_builder.instruction_count; ip++) {
+		compiler_ins_t* ins = &compiler->ins_builder.instructions[ip];
+		switch (ins->op_code)
+		{
+		case COMPILER_OP_CODE_LOAD_ALLOC:
+		case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+		case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
+			ins->op_code = COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT;
+			break;
+		case COMPILER_OP_CODE_LOAD_ALLOC_I:
+		case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
+			ins->op_code = COMPILER_OP_CODE_LOAD_ALLOC_I_INIT;
+			break;
+		case COMPILER_OP_CODE_STORE_ALLOC:
+			ins->op_code = COMPILER_OP_CODE_STORE_ALLOC_INBOUND;
+			break;
+		case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
+			ins->op_code = COMPILER_OP_CODE_STORE_ALLOC_I;
+			break;
+		case COMPILER_OP_CODE_LONG_DIVIDE:
+			ins->op_code = COMPILER_OP_CODE_LONG_DIVIDE_NONZERO;
+			break;
+		}
+	}
+}
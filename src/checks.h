@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef CHECKS_H
+#define CHECKS_H
+
+#include <stdint.h>
+#include "compiler.h"
+
+#define MAX_RANGE_FACTS 16
+
+//what's known about registers at a point in the program
+#define RANGE_FACT_LENGTH 0 //reg holds the length of array
+#define RANGE_FACT_LESS 1 //reg holds whether index is less than the length of array
+#define RANGE_FACT_BOUND 2 //index is less than the length of array
+#define RANGE_FACT_INIT 3 //array is fully initialized, and index is an immediate holding its length
+#define RANGE_FACT_FILLING 4 //array literal whose elements are still being stored, and index is an immediate holding its length
+
+typedef struct range_fact {
+	uint8_t kind;
+	compiler_reg_t reg, index, array;
+} range_fact_t;
+
+typedef struct range_state {
+	range_fact_t facts[MAX_RANGE_FACTS];
+	uint8_t fact_count;
+	int reached;
+} range_state_t;
+
+int elide_checks(compiler_t* compiler);
+void drop_checks(compiler_t* compiler);
+
+#endif // !CHECKS_H
@@ -10,7 +10,7 @@
 #define INS2(OP, REG, REG1) (compiler_ins_t){.op_code = OP, .regs[0] = REG, .regs[1] = REG1}
 #define INS3(OP, REG, REG1, REG2) (compiler_ins_t){.op_code = OP, .regs[0] = REG, .regs[1] = REG1, .regs[2] = REG2}
 
-#define EMIT_INS(INS) PANIC_ON_FAIL(ins_builder_append_ins(&compiler->ins_builder, INS), compiler, ERROR_MEMORY)
+#define EMIT_INS(INS) PANIC_ON_FAIL(emit_ins(compiler, INS), compiler, ERROR_MEMORY)
 
 int init_ins_builder(ins_builder_t* ins_builder, safe_gc_t* safe_gc) {
 	ins_builder->safe_gc = safe_gc;
@@ -21,19 +21,662 @@ int init_ins_builder(ins_builder_t* ins_builder, safe_gc_t* safe_gc) {
 
 int ins_builder_append_ins(ins_builder_t* ins_builder, compiler_ins_t ins) {
 	if (ins_builder->instruction_count == ins_builder->alloced_ins) {
-		compiler_ins_t* new_ins = safe_realloc(ins_builder->safe_gc, ins_builder->instructions, (ins_builder->alloced_ins *= 2) * sizeof(compiler_ins_t));
+		//instruction pointers are kept in 32-bit registers
+		if (ins_builder->alloced_ins > UINT32_MAX / 2)
+			return 0;
+		compiler_ins_t* new_ins = safe_realloc(ins_builder->safe_gc, ins_builder->instructions, ins_builder->alloced_ins * 2 * sizeof(compiler_ins_t));
 		ESCAPE_ON_FAIL(new_ins);
 		ins_builder->instructions = new_ins;
+		ins_builder->alloced_ins *= 2;
 	}
 	ins_builder->instructions[ins_builder->instruction_count++] = ins;
 	return 1;
 }
 
+//appends an instruction, moving its registers and frame offsets into the frame of the proc it's inlined into
+static int emit_ins(compiler_t* compiler, compiler_ins_t ins) {
+	if (compiler->inline_depth) {
+		for (uint_fast8_t i = 0; i < 3; i++)
+			if (ins.regs[i].offset)
+				ins.regs[i].reg += compiler->inline_offset;
+		if (ins.op_code == COMPILER_OP_CODE_CALL)
+			ins.regs[1].reg += compiler->inline_offset;
+		else if (ins.op_code == COMPILER_OP_CODE_STACK_DEOFFSET)
+			ins.regs[0].reg += compiler->inline_offset;
+	}
+	return ins_builder_append_ins(&compiler->ins_builder, ins);
+}
+
+//steps to a proc's next instruction, skipping over the bodies of procs nested in it
+uint32_t next_proc_ip(compiler_ins_t* instructions, uint32_t ip) {
+	ip++;
+	while (instructions[ip].op_code == COMPILER_OP_CODE_LABEL)
+		ip = instructions[ip + 1].regs[0].reg;
+	return ip;
+}
+
+//finds the proc a call goes to, if the call goes through the proc's own register rather than a first-class proc value
+uint16_t find_callee(compiler_t* compiler, compiler_reg_t proc_reg) {
+	if (proc_reg.offset)
+		return UINT16_MAX;
+	for (uint_fast16_t i = 0; i < compiler->proc_count; i++)
+		if (compiler->proc_label_ips[i] != UINT32_MAX && compiler->ins_builder.instructions[compiler->proc_label_ips[i]].regs[0].reg == proc_reg.reg)
+			return i;
+	return UINT16_MAX;
+}
+
+//gets how many registers past its frame pointer any proc, or the top level, may use
+//nothing at or past the current frame pointer plus this span is live, since callers only keep their locals below the frames they call
+uint32_t max_frame_span(compiler_t* compiler) {
+	uint32_t span = 0;
+	for (uint_fast32_t ip = 0; ip < compiler->ins_builder.instruction_count; ip++) {
+		compiler_ins_t ins = compiler->ins_builder.instructions[ip];
+		if (ins.op_code == COMPILER_OP_CODE_STACK_VALIDATE && ins.regs[0].reg > span)
+			span = ins.regs[0].reg;
+		for (uint_fast8_t i = 0; i < 3; i++)
+			if (ins.regs[i].offset == 1 && ins.regs[i].reg + 1 > span)
+				span = ins.regs[i].reg + 1;
+	}
+	return span;
+}
+
+//gets whether each of an instruction's operands is an immediate, or a register it reads and/or writes, calls also move arguments and return values between frames implicitly
+void ins_operand_roles(compiler_ins_t ins, uint8_t* roles) {
+#define ROLES(A, B, C) { roles[0] = (A); roles[1] = (B); roles[2] = (C); return; }
+	switch (ins.op_code)
+	{
+	case COMPILER_OP_CODE_MOVE:
+	case COMPILER_OP_CODE_NOT:
+	case COMPILER_OP_CODE_LENGTH:
+	case COMPILER_OP_CODE_LONG_NEGATE:
+	case COMPILER_OP_CODE_FLOAT_NEGATE:
+		ROLES(OPERAND_WRITE, OPERAND_READ, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_SET:
+	case COMPILER_OP_CODE_LABEL:
+	case COMPILER_OP_CODE_ALLOC_I:
+	case COMPILER_OP_CODE_ALLOC_I_INIT:
+		ROLES(OPERAND_WRITE, OPERAND_IMMEDIATE, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_ALLOC:
+		ROLES(OPERAND_WRITE, OPERAND_READ, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_JUMP_CHECK:
+	case COMPILER_OP_CODE_CALL:
+	case COMPILER_OP_CODE_TAIL_CALL:
+	case COMPILER_OP_CODE_FREE:
+	case COMPILER_OP_CODE_RC_RELEASE:
+	case COMPILER_OP_CODE_GC_TRACE:
+	case COMPILER_OP_CODE_CONF_TRACE:
+	case COMPILER_OP_CODE_CONFIG_TYPESIG:
+		ROLES(OPERAND_READ, OPERAND_IMMEDIATE, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_LOAD_ALLOC:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT:
+	case COMPILER_OP_CODE_AND:
+	case COMPILER_OP_CODE_OR:
+	case COMPILER_OP_CODE_PTR_EQUAL:
+	case COMPILER_OP_CODE_BOOL_EQUAL:
+	case COMPILER_OP_CODE_CHAR_EQUAL:
+	case COMPILER_OP_CODE_LONG_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_EQUAL:
+	case COMPILER_OP_CODE_LONG_MORE:
+	case COMPILER_OP_CODE_LONG_LESS:
+	case COMPILER_OP_CODE_LONG_MORE_EQUAL:
+	case COMPILER_OP_CODE_LONG_LESS_EQUAL:
+	case COMPILER_OP_CODE_LONG_ADD:
+	case COMPILER_OP_CODE_LONG_SUBTRACT:
+	case COMPILER_OP_CODE_LONG_MULTIPLY:
+	case COMPILER_OP_CODE_LONG_DIVIDE:
+	case COMPILER_OP_CODE_LONG_DIVIDE_NONZERO:
+	case COMPILER_OP_CODE_LONG_MODULO:
+	case COMPILER_OP_CODE_LONG_EXPONENTIATE:
+	case COMPILER_OP_CODE_FLOAT_MORE:
+	case COMPILER_OP_CODE_FLOAT_LESS:
+	case COMPILER_OP_CODE_FLOAT_MORE_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_LESS_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_ADD:
+	case COMPILER_OP_CODE_FLOAT_SUBTRACT:
+	case COMPILER_OP_CODE_FLOAT_MULTIPLY:
+	case COMPILER_OP_CODE_FLOAT_DIVIDE:
+	case COMPILER_OP_CODE_FLOAT_MODULO:
+	case COMPILER_OP_CODE_FLOAT_EXPONENTIATE:
+		ROLES(OPERAND_READ, OPERAND_READ, OPERAND_WRITE);
+	case COMPILER_OP_CODE_LOAD_ALLOC_I:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_INIT:
+	case COMPILER_OP_CODE_RUNTIME_TYPECHECK:
+	case COMPILER_OP_CODE_RUNTIME_TYPECAST:
+		ROLES(OPERAND_READ, OPERAND_WRITE, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_STORE_ALLOC:
+	case COMPILER_OP_CODE_STORE_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DD:
+		ROLES(OPERAND_READ, OPERAND_READ, OPERAND_READ);
+	case COMPILER_OP_CODE_DYNAMIC_CONF:
+		ROLES(OPERAND_READ, OPERAND_IMMEDIATE, OPERAND_READ);
+	case COMPILER_OP_CODE_DYNAMIC_CONF_ALL:
+	case COMPILER_OP_CODE_DYNAMIC_FREE:
+	case COMPILER_OP_CODE_DYNAMIC_TRACE:
+	case COMPILER_OP_CODE_STORE_ALLOC_I:
+	case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DR:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_RD:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_ARRAY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY_DOWNCAST:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY:
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY_DOWNCAST:
+	case COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_BOOL_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_CHAR_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS_EQUAL:
+		ROLES(OPERAND_READ, OPERAND_READ, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_LONG_INCREMENT:
+	case COMPILER_OP_CODE_LONG_DECREMENT:
+	case COMPILER_OP_CODE_FLOAT_INCREMENT:
+	case COMPILER_OP_CODE_FLOAT_DECREMENT:
+		ROLES(OPERAND_READ_WRITE, OPERAND_IMMEDIATE, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DD:
+		ROLES(OPERAND_READ_WRITE, OPERAND_READ, OPERAND_READ);
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DR:
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_RD:
+		ROLES(OPERAND_READ_WRITE, OPERAND_READ, OPERAND_IMMEDIATE);
+	case COMPILER_OP_CODE_FOREIGN: //foreign functions get pointers to all of their operands
+		ROLES(OPERAND_READ_WRITE, OPERAND_READ_WRITE, OPERAND_READ_WRITE);
+	default:
+		ROLES(OPERAND_IMMEDIATE, OPERAND_IMMEDIATE, OPERAND_IMMEDIATE);
+	}
+#undef ROLES
+}
+
+static int code_block_inline_cost(ast_code_block_t code_block, ast_proc_t* callee, uint32_t* cost);
+
+//counts the values a proc evaluates towards its inlining cost, failing on anything that can't be spliced into a caller
+static int value_inline_cost(ast_value_t value, ast_proc_t* callee, uint32_t* cost) {
+	if (!value.affects_state)
+		return 1;
+	(*cost)++;
+	switch (value.value_type)
+	{
+	case AST_VALUE_PROC: //procs defined by an inlined body would be compiled more than once
+		return 0;
+	case AST_VALUE_ALLOC_ARRAY:
+		return value_inline_cost(value.data.alloc_array->size, callee, cost);
+	case AST_VALUE_ARRAY_LITERAL:
+		for (uint_fast16_t i = 0; i < value.data.array_literal.element_count; i++)
+			ESCAPE_ON_FAIL(value_inline_cost(value.data.array_literal.elements[i], callee, cost));
+		return 1;
+	case AST_VALUE_ALLOC_RECORD:
+		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++)
+			ESCAPE_ON_FAIL(value_inline_cost(value.data.alloc_record.init_values[i].value, callee, cost));
+		return 1;
+	case AST_VALUE_SET_VAR:
+		return value_inline_cost(value.data.set_var->set_value, callee, cost);
+	case AST_VALUE_SET_INDEX:
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.set_index->array, callee, cost));
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.set_index->index, callee, cost));
+		return value_inline_cost(value.data.set_index->value, callee, cost);
+	case AST_VALUE_SET_PROP:
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.set_prop->record, callee, cost));
+		return value_inline_cost(value.data.set_prop->value, callee, cost);
+	case AST_VALUE_GET_INDEX:
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.get_index->array, callee, cost));
+		return value_inline_cost(value.data.get_index->index, callee, cost);
+	case AST_VALUE_GET_PROP:
+		return value_inline_cost(value.data.get_prop->record, callee, cost);
+	case AST_VALUE_BINARY_OP:
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.binary_op->lhs, callee, cost));
+		return value_inline_cost(value.data.binary_op->rhs, callee, cost);
+	case AST_VALUE_UNARY_OP:
+		return value_inline_cost(value.data.unary_op->operand, callee, cost);
+	case AST_VALUE_TYPE_OP:
+		return value_inline_cost(value.data.type_op->operand, callee, cost);
+	case AST_VALUE_FOREIGN:
+		ESCAPE_ON_FAIL(value_inline_cost(value.data.foreign->op_id, callee, cost));
+		if (value.data.foreign->input)
+			ESCAPE_ON_FAIL(value_inline_cost(*value.data.foreign->input, callee, cost));
+		return 1;
+	case AST_VALUE_PROC_CALL:
+		//recursive procs would splice themselves in endlessly
+		if (value.data.proc_call->procedure.value_type == AST_VALUE_VAR && value.data.proc_call->procedure.data.variable == callee->thisproc)
+			return 0;
+		for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++)
+			ESCAPE_ON_FAIL(value_inline_cost(value.data.proc_call->arguments[i], callee, cost));
+		return value_inline_cost(value.data.proc_call->procedure, callee, cost);
+	}
+	return 1;
+}
+
+static int code_block_inline_cost(ast_code_block_t code_block, ast_proc_t* callee, uint32_t* cost) {
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++) {
+		(*cost)++;
+		switch (code_block.instructions[i].type)
+		{
+		case AST_STATEMENT_DECL_VAR:
+			ESCAPE_ON_FAIL(value_inline_cost(code_block.instructions[i].data.var_decl.set_value, callee, cost));
+			break;
+		case AST_STATEMENT_COND:
+			for (ast_cond_t* conditional = code_block.instructions[i].data.conditional; conditional; conditional = conditional->next_if_false) {
+				if (conditional->condition)
+					ESCAPE_ON_FAIL(value_inline_cost(*conditional->condition, callee, cost));
+				ESCAPE_ON_FAIL(code_block_inline_cost(conditional->exec_block, callee, cost));
+			}
+			break;
+		case AST_STATEMENT_VALUE:
+		case AST_STATEMENT_RETURN_VALUE:
+			ESCAPE_ON_FAIL(value_inline_cost(code_block.instructions[i].data.value, callee, cost));
+			break;
+		}
+	}
+	return 1;
+}
+
+//the proc a call goes to, if it's called directly rather than through a first-class proc value
+static ast_proc_t* find_declared_callee(compiler_t* compiler, ast_value_t procedure) {
+	if (procedure.value_type != AST_VALUE_VAR)
+		return NULL;
+	compiler_reg_t proc_reg = compiler->var_regs[procedure.data.variable->id];
+	if (proc_reg.offset)
+		return NULL;
+	for (uint_fast16_t i = 0; i < compiler->ast->proc_count; i++)
+		if (compiler->procs[i] && compiler->var_regs[compiler->procs[i]->thisproc->id].reg == proc_reg.reg)
+			return compiler->procs[i];
+	return NULL;
+}
+
+//the proc a call's body can be spliced in from
+static ast_proc_t* find_inline_callee(compiler_t* compiler, ast_value_t value) {
+	ast_proc_t* callee = find_declared_callee(compiler, value.data.proc_call->procedure);
+	return (callee && compiler->proc_inlinable[callee->id]) ? callee : NULL;
+}
+
+//the variable an increment or decrement steps
+static ast_var_info_t* stepped_var(ast_value_t value) {
+	if (value.value_type != AST_VALUE_UNARY_OP || (value.data.unary_op->operator != TOK_INCREMENT && value.data.unary_op->operator != TOK_DECREMENT) || value.data.unary_op->operand.value_type != AST_VALUE_VAR)
+		return NULL;
+	return value.data.unary_op->operand.data.variable;
+}
+
+static void clobber_loop_prop(compiler_loop_effects_t* effects, ast_record_prop_t* property) {
+	for (uint_fast8_t i = 0; i < effects->clobbered_prop_count; i++)
+		if (effects->clobbered_props[i] == property->id)
+			return;
+	if (effects->clobbered_prop_count == MAX_LOOP_CLOBBERED_PROPS)
+		effects->clobbers_all = 1;
+	else
+		effects->clobbered_props[effects->clobbered_prop_count++] = property->id;
+}
+
+static void code_block_loop_effects(compiler_t* compiler, ast_code_block_t code_block, compiler_loop_effects_t* effects);
+
+//finds what evaluating a value may write, following calls into the bodies of the procs they go to
+static void value_loop_effects(compiler_t* compiler, ast_value_t value, compiler_loop_effects_t* effects) {
+	if (!value.affects_state)
+		return;
+	switch (value.value_type)
+	{
+	case AST_VALUE_ALLOC_ARRAY:
+		value_loop_effects(compiler, value.data.alloc_array->size, effects);
+		return;
+	case AST_VALUE_ARRAY_LITERAL:
+		for (uint_fast16_t i = 0; i < value.data.array_literal.element_count; i++)
+			value_loop_effects(compiler, value.data.array_literal.elements[i], effects);
+		return;
+	case AST_VALUE_ALLOC_RECORD:
+		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++)
+			value_loop_effects(compiler, value.data.alloc_record.init_values[i].value, effects);
+		return;
+	case AST_VALUE_SET_VAR:
+		effects->var_writes[value.data.set_var->var_info->id] |= LOOP_VAR_ASSIGNED;
+		value_loop_effects(compiler, value.data.set_var->set_value, effects);
+		return;
+	case AST_VALUE_SET_INDEX:
+		value_loop_effects(compiler, value.data.set_index->array, effects);
+		value_loop_effects(compiler, value.data.set_index->index, effects);
+		value_loop_effects(compiler, value.data.set_index->value, effects);
+		return;
+	case AST_VALUE_SET_PROP:
+		clobber_loop_prop(effects, value.data.set_prop->property);
+		value_loop_effects(compiler, value.data.set_prop->record, effects);
+		value_loop_effects(compiler, value.data.set_prop->value, effects);
+		return;
+	case AST_VALUE_GET_INDEX:
+		value_loop_effects(compiler, value.data.get_index->array, effects);
+		value_loop_effects(compiler, value.data.get_index->index, effects);
+		return;
+	case AST_VALUE_GET_PROP:
+		value_loop_effects(compiler, value.data.get_prop->record, effects);
+		return;
+	case AST_VALUE_BINARY_OP:
+		value_loop_effects(compiler, value.data.binary_op->lhs, effects);
+		value_loop_effects(compiler, value.data.binary_op->rhs, effects);
+		return;
+	case AST_VALUE_UNARY_OP:
+		//steps that aren't statements of their own are read mid-expression, so they're treated as any other assignment
+		if (stepped_var(value))
+			effects->var_writes[stepped_var(value)->id] |= LOOP_VAR_ASSIGNED;
+		else if ((value.data.unary_op->operator == TOK_INCREMENT || value.data.unary_op->operator == TOK_DECREMENT) && value.data.unary_op->operand.value_type == AST_VALUE_GET_PROP)
+			clobber_loop_prop(effects, value.data.unary_op->operand.data.get_prop->property);
+		value_loop_effects(compiler, value.data.unary_op->operand, effects);
+		return;
+	case AST_VALUE_TYPE_OP:
+		value_loop_effects(compiler, value.data.type_op->operand, effects);
+		return;
+	case AST_VALUE_FOREIGN:
+		effects->clobbers_all = 1;
+		value_loop_effects(compiler, value.data.foreign->op_id, effects);
+		if (value.data.foreign->input)
+			value_loop_effects(compiler, *value.data.foreign->input, effects);
+		return;
+	case AST_VALUE_PROC_CALL: {
+		for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++)
+			value_loop_effects(compiler, value.data.proc_call->arguments[i], effects);
+		value_loop_effects(compiler, value.data.proc_call->procedure, effects);
+
+		ast_proc_t* callee = find_declared_callee(compiler, value.data.proc_call->procedure);
+		if (!callee)
+			effects->clobbers_all = 1;
+		else if (!effects->visited_procs[callee->id]) {
+			effects->visited_procs[callee->id] = 1;
+			code_block_loop_effects(compiler, callee->exec_block, effects);
+		}
+		return;
+	}
+	}
+}
+
+static void code_block_loop_effects(compiler_t* compiler, ast_code_block_t code_block, compiler_loop_effects_t* effects) {
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+		switch (code_block.instructions[i].type)
+		{
+		case AST_STATEMENT_DECL_VAR:
+			effects->var_writes[code_block.instructions[i].data.var_decl.var_info->id] |= LOOP_VAR_ASSIGNED;
+			value_loop_effects(compiler, code_block.instructions[i].data.var_decl.set_value, effects);
+			break;
+		case AST_STATEMENT_COND:
+			for (ast_cond_t* conditional = code_block.instructions[i].data.conditional; conditional; conditional = conditional->next_if_false) {
+				if (conditional->condition)
+					value_loop_effects(compiler, *conditional->condition, effects);
+				code_block_loop_effects(compiler, conditional->exec_block, effects);
+			}
+			break;
+		case AST_STATEMENT_VALUE:
+			if (stepped_var(code_block.instructions[i].data.value))
+				effects->var_writes[stepped_var(code_block.instructions[i].data.value)->id] |= LOOP_VAR_STEPPED;
+			else
+				value_loop_effects(compiler, code_block.instructions[i].data.value, effects);
+			break;
+		case AST_STATEMENT_RETURN_VALUE:
+			value_loop_effects(compiler, code_block.instructions[i].data.value, effects);
+			break;
+		}
+}
+
+//whether a value is the same on every iteration of a loop, and can be evaluated before the loop without faulting or writing anything
+static int loop_invariant(ast_value_t value, compiler_loop_effects_t* effects) {
+	if (value.free_status != POSTPROC_FREE_NONE || value.trace_status != POSTPROC_TRACE_NONE)
+		return 0;
+	switch (value.value_type)
+	{
+	case AST_VALUE_PRIMITIVE:
+		return 1;
+	case AST_VALUE_VAR:
+		return !effects->var_writes[value.data.variable->id] && !(value.data.variable->is_global && effects->clobbers_all);
+	case AST_VALUE_GET_PROP:
+		//properties that aren't deferinit are initialized by every constructor, so reading them can't fail
+		if (value.data.get_prop->property->defer_init || effects->clobbers_all)
+			return 0;
+		for (uint_fast8_t i = 0; i < effects->clobbered_prop_count; i++)
+			if (effects->clobbered_props[i] == value.data.get_prop->property->id)
+				return 0;
+		return loop_invariant(value.data.get_prop->record, effects);
+	case AST_VALUE_UNARY_OP:
+		if (value.data.unary_op->operator == TOK_HASHTAG && effects->clobbers_all)
+			return 0; //foreign functions may resize arrays in place
+		return (value.data.unary_op->operator == TOK_NOT || value.data.unary_op->operator == TOK_HASHTAG || value.data.unary_op->operator == TOK_SUBTRACT) && loop_invariant(value.data.unary_op->operand, effects);
+	case AST_VALUE_BINARY_OP:
+		//hoisted values are evaluated even if the code using them never runs, and long powers never finish with negative exponents
+		if (value.data.binary_op->operator == TOK_POWER && value.type.type == TYPE_PRIMITIVE_LONG)
+			return 0;
+		return value.data.binary_op->operator != TOK_DIVIDE && value.data.binary_op->operator != TOK_MODULO && loop_invariant(value.data.binary_op->lhs, effects) && loop_invariant(value.data.binary_op->rhs, effects);
+	}
+	return 0;
+}
+
+//the variable a value reads, if it's a local long that the loop only ever steps in statements of their own
+static ast_var_info_t* loop_induction_var(ast_value_t value, compiler_loop_effects_t* effects) {
+	if (value.value_type != AST_VALUE_VAR || value.data.variable->is_global || value.data.variable->type.type != TYPE_PRIMITIVE_LONG || effects->var_writes[value.data.variable->id] != LOOP_VAR_STEPPED)
+		return NULL;
+	return value.data.variable;
+}
+
+static int add_loop_hoist(compiler_t* compiler, ast_cond_t* loop, ast_value_t value, ast_var_info_t* induction_var, ast_value_t* step) {
+	if (compiler->loop_hoist_count == compiler->alloced_loop_hoists) {
+		if (compiler->alloced_loop_hoists > UINT16_MAX / 2)
+			return 0;
+		compiler_loop_hoist_t* new_hoists = safe_realloc(compiler->safe_gc, compiler->loop_hoists, compiler->alloced_loop_hoists * 2 * sizeof(compiler_loop_hoist_t));
+		if (!new_hoists)
+			return 0; //the value is just evaluated where it's used
+		compiler->loop_hoists = new_hoists;
+		compiler->alloced_loop_hoists *= 2;
+	}
+	compiler->loop_hoists[compiler->loop_hoist_count++] = (compiler_loop_hoist_t){ .loop = loop, .value = value, .induction_var = induction_var, .step = step, .active = 0 };
+	compiler->hoisted_values[value.id] = 1;
+	return 1;
+}
+
+static void find_code_block_loop_hoists(compiler_t* compiler, ast_cond_t* loop, ast_code_block_t code_block, compiler_loop_effects_t* effects);
+
+//finds the largest invariant values in a loop, and the products of its induction variables and invariant steps
+static void find_loop_hoists(compiler_t* compiler, ast_cond_t* loop, ast_value_t* value, compiler_loop_effects_t* effects) {
+	if (!value->affects_state || compiler->hoisted_values[value->id])
+		return;
+	if (value->value_type != AST_VALUE_PRIMITIVE && value->value_type != AST_VALUE_VAR && loop_invariant(*value, effects) && add_loop_hoist(compiler, loop, *value, NULL, NULL))
+		return;
+	switch (value->value_type)
+	{
+	case AST_VALUE_ALLOC_ARRAY:
+		find_loop_hoists(compiler, loop, &value->data.alloc_array->size, effects);
+		return;
+	case AST_VALUE_ARRAY_LITERAL:
+		for (uint_fast16_t i = 0; i < value->data.array_literal.element_count; i++)
+			find_loop_hoists(compiler, loop, &value->data.array_literal.elements[i], effects);
+		return;
+	case AST_VALUE_ALLOC_RECORD:
+		for (uint_fast16_t i = 0; i < value->data.alloc_record.init_value_count; i++)
+			find_loop_hoists(compiler, loop, &value->data.alloc_record.init_values[i].value, effects);
+		return;
+	case AST_VALUE_SET_VAR:
+		find_loop_hoists(compiler, loop, &value->data.set_var->set_value, effects);
+		return;
+	case AST_VALUE_SET_INDEX:
+		find_loop_hoists(compiler, loop, &value->data.set_index->array, effects);
+		find_loop_hoists(compiler, loop, &value->data.set_index->index, effects);
+		find_loop_hoists(compiler, loop, &value->data.set_index->value, effects);
+		return;
+	case AST_VALUE_SET_PROP:
+		find_loop_hoists(compiler, loop, &value->data.set_prop->record, effects);
+		find_loop_hoists(compiler, loop, &value->data.set_prop->value, effects);
+		return;
+	case AST_VALUE_GET_INDEX:
+		find_loop_hoists(compiler, loop, &value->data.get_index->array, effects);
+		find_loop_hoists(compiler, loop, &value->data.get_index->index, effects);
+		return;
+	case AST_VALUE_GET_PROP:
+		find_loop_hoists(compiler, loop, &value->data.get_prop->record, effects);
+		return;
+	case AST_VALUE_BINARY_OP: {
+		ast_binary_op_t* binary_op = value->data.binary_op;
+		if (binary_op->operator == TOK_MULTIPLY && value->type.type == TYPE_PRIMITIVE_LONG && value->free_status == POSTPROC_FREE_NONE && value->trace_status == POSTPROC_TRACE_NONE) {
+			ast_var_info_t* induction_var;
+			ast_value_t* step = NULL;
+			if ((induction_var = loop_induction_var(binary_op->lhs, effects)) && loop_invariant(binary_op->rhs, effects))
+				step = &binary_op->rhs;
+			else if ((induction_var = loop_induction_var(binary_op->rhs, effects)) && loop_invariant(binary_op->lhs, effects))
+				step = &binary_op->lhs;
+
+			//the step has to be kept in a register of its own for the whole loop
+			if (step && (step->value_type == AST_VALUE_PRIMITIVE || step->value_type == AST_VALUE_VAR || add_loop_hoist(compiler, loop, *step, NULL, NULL)) && add_loop_hoist(compiler, loop, *value, induction_var, step))
+				return;
+		}
+		find_loop_hoists(compiler, loop, &binary_op->lhs, effects);
+		find_loop_hoists(compiler, loop, &binary_op->rhs, effects);
+		return;
+	}
+	case AST_VALUE_UNARY_OP:
+		find_loop_hoists(compiler, loop, &value->data.unary_op->operand, effects);
+		return;
+	case AST_VALUE_TYPE_OP:
+		find_loop_hoists(compiler, loop, &value->data.type_op->operand, effects);
+		return;
+	case AST_VALUE_FOREIGN:
+		find_loop_hoists(compiler, loop, &value->data.foreign->op_id, effects);
+		if (value->data.foreign->input)
+			find_loop_hoists(compiler, loop, value->data.foreign->input, effects);
+		return;
+	case AST_VALUE_PROC_CALL:
+		for (uint_fast8_t i = 0; i < value->data.proc_call->argument_count; i++)
+			find_loop_hoists(compiler, loop, &value->data.proc_call->arguments[i], effects);
+		find_loop_hoists(compiler, loop, &value->data.proc_call->procedure, effects);
+		return;
+	}
+}
+
+static void find_code_block_loop_hoists(compiler_t* compiler, ast_cond_t* loop, ast_code_block_t code_block, compiler_loop_effects_t* effects) {
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+		switch (code_block.instructions[i].type)
+		{
+		case AST_STATEMENT_DECL_VAR:
+			find_loop_hoists(compiler, loop, &code_block.instructions[i].data.var_decl.set_value, effects);
+			break;
+		case AST_STATEMENT_COND:
+			for (ast_cond_t* conditional = code_block.instructions[i].data.conditional; conditional; conditional = conditional->next_if_false) {
+				if (conditional->condition)
+					find_loop_hoists(compiler, loop, conditional->condition, effects);
+				find_code_block_loop_hoists(compiler, loop, conditional->exec_block, effects);
+			}
+			break;
+		case AST_STATEMENT_VALUE:
+		case AST_STATEMENT_RETURN_VALUE:
+			find_loop_hoists(compiler, loop, &code_block.instructions[i].data.value, effects);
+			break;
+		}
+}
+
+//whether a declared variable is never set again, and so just shares the register of the constant, proc or variable it's declared as
+static int decl_shares_reg(ast_decl_var_t var_decl) {
+	return !var_decl.var_info->has_mutated &&
+		(var_decl.set_value.value_type == AST_VALUE_PRIMITIVE ||
+			var_decl.set_value.value_type == AST_VALUE_PROC ||
+
+		(var_decl.set_value.value_type == AST_VALUE_VAR && !var_decl.set_value.data.variable->has_mutated) &&
+			!(var_decl.var_info->is_global && !var_decl.set_value.data.variable->is_global));
+}
+
+static uint32_t var_slot_root(compiler_t* compiler, ast_var_info_t* var_info) {
+	return compiler->var_alias_roots[var_info->id] == UINT32_MAX ? var_info->id : compiler->var_alias_roots[var_info->id];
+}
+
+static void mark_statement_var_uses(compiler_t* compiler, ast_statement_t* statement, uint32_t index);
+
+//records a value's variables as used by a statement of the block being allocated, crediting variables that share another's register to the other
+static void mark_value_var_uses(compiler_t* compiler, ast_value_t value, uint32_t index) {
+	switch (value.value_type)
+	{
+	case AST_VALUE_VAR:
+		compiler->var_last_uses[var_slot_root(compiler, value.data.variable)] = index;
+		return;
+	case AST_VALUE_ALLOC_ARRAY:
+		mark_value_var_uses(compiler, value.data.alloc_array->size, index);
+		return;
+	case AST_VALUE_ARRAY_LITERAL:
+		for (uint_fast16_t i = 0; i < value.data.array_literal.element_count; i++)
+			mark_value_var_uses(compiler, value.data.array_literal.elements[i], index);
+		return;
+	case AST_VALUE_ALLOC_RECORD:
+		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++)
+			mark_value_var_uses(compiler, value.data.alloc_record.init_values[i].value, index);
+		return;
+	case AST_VALUE_SET_VAR:
+		compiler->var_last_uses[var_slot_root(compiler, value.data.set_var->var_info)] = index;
+		mark_value_var_uses(compiler, value.data.set_var->set_value, index);
+		return;
+	case AST_VALUE_SET_INDEX:
+		mark_value_var_uses(compiler, value.data.set_index->array, index);
+		mark_value_var_uses(compiler, value.data.set_index->index, index);
+		mark_value_var_uses(compiler, value.data.set_index->value, index);
+		return;
+	case AST_VALUE_SET_PROP:
+		mark_value_var_uses(compiler, value.data.set_prop->record, index);
+		mark_value_var_uses(compiler, value.data.set_prop->value, index);
+		return;
+	case AST_VALUE_GET_INDEX:
+		mark_value_var_uses(compiler, value.data.get_index->array, index);
+		mark_value_var_uses(compiler, value.data.get_index->index, index);
+		return;
+	case AST_VALUE_GET_PROP:
+		mark_value_var_uses(compiler, value.data.get_prop->record, index);
+		return;
+	case AST_VALUE_BINARY_OP:
+		mark_value_var_uses(compiler, value.data.binary_op->lhs, index);
+		mark_value_var_uses(compiler, value.data.binary_op->rhs, index);
+		return;
+	case AST_VALUE_UNARY_OP:
+		mark_value_var_uses(compiler, value.data.unary_op->operand, index);
+		return;
+	case AST_VALUE_TYPE_OP:
+		mark_value_var_uses(compiler, value.data.type_op->operand, index);
+		return;
+	case AST_VALUE_FOREIGN:
+		mark_value_var_uses(compiler, value.data.foreign->op_id, index);
+		if (value.data.foreign->input)
+			mark_value_var_uses(compiler, *value.data.foreign->input, index);
+		return;
+	case AST_VALUE_PROC_CALL:
+		for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++)
+			mark_value_var_uses(compiler, value.data.proc_call->arguments[i], index);
+		mark_value_var_uses(compiler, value.data.proc_call->procedure, index);
+		return;
+	}
+}
+
+static void mark_statement_var_uses(compiler_t* compiler, ast_statement_t* statement, uint32_t index) {
+	switch (statement->type)
+	{
+	case AST_STATEMENT_DECL_VAR:
+		if (decl_shares_reg(statement->data.var_decl) && statement->data.var_decl.set_value.value_type == AST_VALUE_VAR)
+			compiler->var_alias_roots[statement->data.var_decl.var_info->id] = var_slot_root(compiler, statement->data.var_decl.set_value.data.variable);
+		else
+			compiler->var_last_uses[statement->data.var_decl.var_info->id] = index;
+		mark_value_var_uses(compiler, statement->data.var_decl.set_value, index);
+		break;
+	case AST_STATEMENT_COND:
+		for (ast_cond_t* conditional = statement->data.conditional; conditional; conditional = conditional->next_if_false) {
+			if (conditional->condition)
+				mark_value_var_uses(compiler, *conditional->condition, index);
+			for (uint_fast32_t i = 0; i < conditional->exec_block.instruction_count; i++)
+				mark_statement_var_uses(compiler, &conditional->exec_block.instructions[i], index);
+		}
+		break;
+	case AST_STATEMENT_VALUE:
+	case AST_STATEMENT_RETURN_VALUE:
+		mark_value_var_uses(compiler, statement->data.value, index);
+		break;
+	}
+}
+
 static void allocate_code_block_regs(compiler_t* compiler, ast_code_block_t code_block, uint16_t current_reg, ast_proc_t* proc);
 
 #define ALLOC_LOC(REG) LOC_REG((proc && (REG) > compiler->proc_call_max_locals[proc->id]) ? (compiler->proc_call_max_locals[proc->id] = (REG)) : (REG))
 static uint16_t allocate_value_regs(compiler_t* compiler, ast_value_t value, uint16_t current_reg, compiler_reg_t* target_reg, ast_proc_t* proc) {
-	if (!value.affects_state)
+	if (!value.affects_state || compiler->hoisted_values[value.id])
 		return current_reg;
 	uint16_t extra_regs = current_reg;
 	switch (value.value_type)
@@ -58,6 +701,9 @@ static uint16_t allocate_value_regs(compiler_t* compiler, ast_value_t value, uin
 	case AST_VALUE_PROC: {
 		compiler->var_regs[value.data.procedure->thisproc->id] = compiler->eval_regs[value.id] = GLOB_REG(compiler->ast->constant_count + compiler->current_global++);
 		compiler->move_eval[value.id] = 1;
+		compiler->procs[value.data.procedure->id] = value.data.procedure;
+		if (proc)
+			compiler->proc_nests_procs[proc->id] = 1;
 
 		uint16_t current_arg_reg = 1;
 
@@ -67,6 +713,11 @@ static uint16_t allocate_value_regs(compiler_t* compiler, ast_value_t value, uin
 		}
 
 		allocate_code_block_regs(compiler, value.data.procedure->exec_block, current_arg_reg + value.type.type_id, value.data.procedure);
+
+		//only small top level procs without a gc-frame of their own are inlined, generic ones only as their clones
+		uint32_t cost = 0;
+		if (compiler->inline_limit && !proc && (!value.type.type_id || compiler->mono_limit) && !value.data.procedure->do_gc && code_block_inline_cost(value.data.procedure->exec_block, value.data.procedure, &cost))
+			compiler->proc_inlinable[value.data.procedure->id] = cost <= compiler->inline_limit;
 		return current_reg;
 	}
 	case AST_VALUE_VAR:
@@ -144,6 +795,10 @@ static uint16_t allocate_value_regs(compiler_t* compiler, ast_value_t value, uin
 		}
 		allocate_value_regs(compiler, value.data.proc_call->procedure, extra_regs, NULL, proc);
 
+		//an inlined callee's frame is laid over the call's stack area, within the caller's own frame
+		ast_proc_t* callee = compiler->inline_callees[value.data.proc_call->id] = find_inline_callee(compiler, value);
+		if (callee && proc && compiler->proc_call_offsets[value.data.proc_call->id] + compiler->proc_call_max_locals[callee->id] > compiler->proc_call_max_locals[proc->id])
+			compiler->proc_call_max_locals[proc->id] = compiler->proc_call_offsets[value.data.proc_call->id] + compiler->proc_call_max_locals[callee->id];
 		return current_reg + 1;
 	}
 	case AST_VALUE_FOREIGN:
@@ -164,19 +819,73 @@ static uint16_t allocate_value_regs(compiler_t* compiler, ast_value_t value, uin
 	return current_reg;
 }
 
+//gives each value hoisted out of a loop a register of its own for the whole loop, returning the first register free for the loop's body
+static uint16_t allocate_loop_hoists(compiler_t* compiler, ast_cond_t* loop, uint16_t current_reg, ast_proc_t* proc) {
+	compiler_loop_effects_t effects = { .clobbered_prop_count = 0, .clobbers_all = 0 };
+	effects.var_writes = safe_calloc(compiler->safe_gc, compiler->ast->var_decl_count, sizeof(uint8_t));
+	effects.visited_procs = safe_calloc(compiler->safe_gc, compiler->ast->proc_count, sizeof(uint8_t));
+	if (!effects.var_writes || !effects.visited_procs) {
+		if (effects.var_writes)
+			safe_free(compiler->safe_gc, effects.var_writes);
+		if (effects.visited_procs)
+			safe_free(compiler->safe_gc, effects.visited_procs);
+		return current_reg; //the loop is left as is
+	}
+
+	value_loop_effects(compiler, *loop->condition, &effects);
+	code_block_loop_effects(compiler, loop->exec_block, &effects);
+
+	uint16_t first_hoist = compiler->loop_hoist_count;
+	find_loop_hoists(compiler, loop, loop->condition, &effects);
+	find_code_block_loop_hoists(compiler, loop, loop->exec_block, &effects);
+	safe_free(compiler->safe_gc, effects.var_writes);
+	safe_free(compiler->safe_gc, effects.visited_procs);
+
+	uint16_t body_reg = current_reg + (compiler->loop_hoist_count - first_hoist);
+	for (uint_fast16_t i = first_hoist; i < compiler->loop_hoist_count; i++) {
+		compiler_reg_t hoist_reg = ALLOC_LOC(current_reg + (i - first_hoist));
+		ast_value_t value = compiler->loop_hoists[i].value;
+
+		//temporaries used while evaluating a hoisted value are dead by the time the loop's entered
+		compiler->hoisted_values[value.id] = 0;
+		allocate_value_regs(compiler, value, body_reg, &hoist_reg, proc);
+		compiler->hoisted_values[value.id] = 1;
+		compiler->eval_regs[value.id] = hoist_reg;
+		compiler->move_eval[value.id] = 1;
+	}
+	return body_reg;
+}
+
+//whether a variable of the block still holds a register going into a statement
+static int block_slot_live(compiler_block_slot_t* slots, uint32_t slot_count, uint16_t reg, uint32_t index) {
+	for (uint_fast32_t i = 0; i < slot_count; i++)
+		if (slots[i].reg == reg && slots[i].last_use >= index)
+			return 1;
+	return 0;
+}
+
 static void allocate_code_block_regs(compiler_t* compiler, ast_code_block_t code_block, uint16_t current_reg, ast_proc_t* proc) {
-	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+	//with compacted frames, variables are colored by the statements they're live over, and everything else starts past the highest live one
+	compiler_block_slot_t* slots = NULL;
+	uint32_t slot_count = 0;
+	uint16_t block_reg = current_reg;
+	if (compiler->compact_frames && code_block.instruction_count && (slots = safe_malloc(compiler->safe_gc, code_block.instruction_count * sizeof(compiler_block_slot_t))))
+		for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+			mark_statement_var_uses(compiler, &code_block.instructions[i], i);
+
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++) {
+		if (slots) {
+			current_reg = block_reg;
+			for (uint_fast32_t j = 0; j < slot_count; j++)
+				if (slots[j].last_use >= i && slots[j].reg >= current_reg)
+					current_reg = slots[j].reg + 1;
+		}
+
 		switch (code_block.instructions[i].type)
 		{
 		case AST_STATEMENT_DECL_VAR: {
 			ast_decl_var_t var_decl = code_block.instructions[i].data.var_decl;
-			if (!var_decl.var_info->has_mutated &&
-				(var_decl.set_value.value_type == AST_VALUE_PRIMITIVE ||
-					var_decl.set_value.value_type == AST_VALUE_PROC ||
-
-				(var_decl.set_value.value_type == AST_VALUE_VAR && !var_decl.set_value.data.variable->has_mutated) &&
-					!(var_decl.var_info->is_global && !var_decl.set_value.data.variable->is_global))
-			) {
+			if (decl_shares_reg(var_decl)) {
 				current_reg = allocate_value_regs(compiler, var_decl.set_value, current_reg, NULL, proc);
 				if (var_decl.var_info->is_used) {
 					compiler->var_regs[var_decl.var_info->id] = compiler->eval_regs[var_decl.set_value.id];
@@ -194,9 +903,19 @@ static void allocate_code_block_regs(compiler_t* compiler, ast_code_block_t code
 				}
 				else {
 					if (var_decl.var_info->is_used) {
-						compiler->var_regs[var_decl.var_info->id] = ALLOC_LOC(current_reg);
+						uint16_t var_reg = current_reg;
+						if (slots) {
+							var_reg = block_reg;
+							while (var_reg < current_reg && block_slot_live(slots, slot_count, var_reg, i))
+								var_reg++;
+							//reference counting releases reference typed locals at the end of their block, which reads their registers
+							uint32_t last_use = (compiler->rc_mode && (IS_REF_TYPE(var_decl.var_info->type) || var_decl.var_info->type.type == TYPE_TYPEARG)) ? UINT32_MAX : compiler->var_last_uses[var_decl.var_info->id];
+							slots[slot_count++] = (compiler_block_slot_t){ .reg = var_reg, .last_use = last_use };
+						}
+						compiler->var_regs[var_decl.var_info->id] = ALLOC_LOC(var_reg);
 						allocate_value_regs(compiler, var_decl.set_value, current_reg, &compiler->var_regs[var_decl.var_info->id], proc);
-						current_reg++;
+						if (var_reg == current_reg)
+							current_reg++;
 					}
 					else if (var_decl.set_value.affects_state)
 						allocate_value_regs(compiler, var_decl.set_value, current_reg, NULL, proc);
@@ -206,11 +925,14 @@ static void allocate_code_block_regs(compiler_t* compiler, ast_code_block_t code
 		}
 		case AST_STATEMENT_COND: {
 			ast_cond_t* conditional = code_block.instructions[i].data.conditional;
+			uint16_t cond_reg = current_reg;
+			if (conditional->next_if_true && compiler->optimize_loops)
+				cond_reg = allocate_loop_hoists(compiler, conditional, current_reg, proc);
 			while (conditional)
 			{
 				if (conditional->condition)
-					allocate_value_regs(compiler, *conditional->condition, current_reg, NULL, proc);
-				allocate_code_block_regs(compiler, conditional->exec_block, current_reg, proc);
+					allocate_value_regs(compiler, *conditional->condition, cond_reg, NULL, proc);
+				allocate_code_block_regs(compiler, conditional->exec_block, cond_reg, proc);
 				conditional = conditional->next_if_false;
 			}
 			break;
@@ -226,59 +948,368 @@ static void allocate_code_block_regs(compiler_t* compiler, ast_code_block_t code
 			break;
 		}
 		}
+	}
+	if (slots)
+		safe_free(compiler->safe_gc, slots);
 }
 #undef ALLOC_LOC
 
 #define TYPEARG_INFO_REG(TYPE) LOC_REG(proc->param_count + 1 + ((TYPE).type_id)) // compiler->proc_generic_regs[proc->id][(TYPE).type_id]
+#define PROC_ID(PROC) (compiler->current_clone ? compiler->current_clone->id : (PROC)->id)
+#define MARK_LOCAL(REG, KIND) mark_local(compiler, proc, REG, KIND)
+#define HAS_TYPEARGS(TYPE) (!compiler->current_clone && typecheck_has_type(TYPE, TYPE_TYPEARG)) //a clone's types are all concrete
+#define SRC_LOC(SRC_LOC_ID) (compiler->inline_depth ? copy_src_loc(compiler, compiler->inline_src_locs, SRC_LOC_ID) : compiler->current_clone ? copy_src_loc(compiler, compiler->current_clone->src_locs, SRC_LOC_ID) : (SRC_LOC_ID))
 
-static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block, ast_proc_t* proc, uint16_t continue_ip, uint16_t* break_jumps, uint8_t* break_jump_top);
+static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block, ast_proc_t* proc, uint32_t continue_ip, uint32_t* break_jumps, uint8_t* break_jump_top);
+static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* proc);
 static machine_type_sig_t* compiler_define_typesig(compiler_t* compiler, ast_proc_t* proc, typecheck_type_t type);
 
+//the concrete type a type argument stands for in the clone being compiled
+static typecheck_type_t mono_type(compiler_t* compiler, typecheck_type_t type) {
+	if (compiler->current_clone && type.type == TYPE_TYPEARG)
+		return compiler->current_clone->typeargs[type.type_id];
+	return type;
+}
+
+//a clone's, or an inlined body's, instructions get their own copies of its proc's source locations, since a location only spans one range of instructions
+static uint32_t copy_src_loc(compiler_t* compiler, uint32_t* src_locs, uint32_t src_loc_id) {
+	if (src_locs[src_loc_id] == UINT32_MAX && !debug_table_copy_loc(compiler->ast->dbg_table, src_loc_id, &src_locs[src_loc_id]))
+		return src_loc_id;
+	return src_locs[src_loc_id];
+}
+
+//marks what a register of the frame being compiled holds, an inlined proc's registers being in its caller's frame
+static void mark_local(compiler_t* compiler, ast_proc_t* proc, compiler_reg_t reg, uint8_t kind) {
+	uint16_t frame = proc ? PROC_ID(proc) : UINT16_MAX;
+	if (compiler->inline_depth) {
+		frame = compiler->inline_frame;
+		reg.reg += compiler->inline_offset;
+	}
+	if (frame != UINT16_MAX && reg.offset && reg.reg <= compiler->proc_call_max_locals[frame])
+		compiler->proc_local_kinds[frame][reg.reg] |= kind;
+}
+
 static int compile_force_free(compiler_t* compiler, compiler_reg_t reg, typecheck_type_t type, ast_proc_t* proc, postproc_free_status_t free_stat) {
-	if (free_stat == POSTPROC_FREE)
+	if (free_stat == POSTPROC_FREE || (free_stat == POSTPROC_FREE_DYNAMIC && compiler->current_clone && IS_REF_TYPE(mono_type(compiler, type))))
 		EMIT_INS(INS1(COMPILER_OP_CODE_FREE, reg))
-	else if (free_stat == POSTPROC_FREE_DYNAMIC)
+	else if (free_stat == POSTPROC_FREE_DYNAMIC && !compiler->current_clone)
 		EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_FREE, reg, TYPEARG_INFO_REG(type)));
 	return 1;
 }
 
+//remembers a reference typed local going into scope, so that reference counting can release it once it's left
+static int push_rc_local(compiler_t* compiler, compiler_reg_t reg) {
+	if (compiler->rc_local_count == compiler->alloced_rc_locals) {
+		PANIC_ON_FAIL(compiler->alloced_rc_locals <= UINT16_MAX / 2, compiler, ERROR_MEMORY);
+		compiler_reg_t* new_rc_locals = safe_realloc(compiler->safe_gc, compiler->rc_locals, compiler->alloced_rc_locals * 2 * sizeof(compiler_reg_t));
+		PANIC_ON_FAIL(new_rc_locals, compiler, ERROR_MEMORY);
+		compiler->rc_locals = new_rc_locals;
+		compiler->alloced_rc_locals *= 2;
+	}
+	compiler->rc_locals[compiler->rc_local_count++] = reg;
+	return 1;
+}
+
+//releases the locals declared since a scope began, references from the stack aren't counted so any of them may have held the last one
+static int release_rc_locals(compiler_t* compiler, uint16_t scope_base) {
+	for (uint_fast16_t i = compiler->rc_local_count; i-- > scope_base;)
+		EMIT_INS(INS1(COMPILER_OP_CODE_RC_RELEASE, compiler->rc_locals[i]));
+	return 1;
+}
+
+//traces a value whose type is a type argument, which a clone only traces if the type argument is a reference type
+static int compile_dynamic_trace(compiler_t* compiler, compiler_reg_t reg, typecheck_type_t type, ast_proc_t* proc) {
+	if (!compiler->current_clone)
+		EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_TRACE, reg, TYPEARG_INFO_REG(type)))
+	else if (IS_REF_TYPE(mono_type(compiler, type)))
+		EMIT_INS(INS2(COMPILER_OP_CODE_GC_TRACE, reg, GLOB_REG(1)));
+	return 1;
+}
+
+//the generic proc a call goes to, if it's called directly rather than through a first-class proc value
+static ast_proc_t* find_generic_callee(compiler_t* compiler, ast_value_t value) {
+	compiler_reg_t proc_reg = compiler->eval_regs[value.data.proc_call->procedure.id];
+	if (proc_reg.offset || !value.data.proc_call->procedure.type.type_id)
+		return NULL;
+	for (uint_fast16_t i = 0; i < compiler->ast->proc_count; i++)
+		if (compiler->procs[i] && compiler->var_regs[compiler->procs[i]->thisproc->id].reg == proc_reg.reg)
+			return compiler->procs[i];
+	return NULL;
+}
+
+static int typecheck_types_eq(typecheck_type_t a, typecheck_type_t b) {
+	if (a.type != b.type || a.type_id != b.type_id)
+		return 0;
+	if (HAS_SUBTYPES(a)) {
+		if (a.sub_type_count != b.sub_type_count)
+			return 0;
+		for (uint_fast8_t i = 0; i < a.sub_type_count; i++)
+			if (!typecheck_types_eq(a.sub_types[i], b.sub_types[i]))
+				return 0;
+	}
+	return 1;
+}
+
+//gets a call's type arguments, after substituting the type arguments of the clone being compiled; fails if any is still generic
+static int mono_typeargs(compiler_t* compiler, ast_value_t value, safe_gc_t* safe_gc, typecheck_type_t* typeargs) {
+	for (uint_fast8_t i = 0; i < value.data.proc_call->procedure.type.type_id; i++) {
+		ESCAPE_ON_FAIL(copy_typecheck_type(safe_gc, &typeargs[i], value.data.proc_call->typeargs[i]));
+		if (compiler->current_clone)
+			ESCAPE_ON_FAIL(typeargs_substitute(safe_gc, compiler->current_clone->typeargs, &typeargs[i]));
+		if (typecheck_has_type(typeargs[i], TYPE_TYPEARG))
+			return 0;
+	}
+	return 1;
+}
+
+static compiler_mono_clone_t* find_mono_clone(compiler_t* compiler, uint16_t proc_id, typecheck_type_t* typeargs, uint8_t typearg_count) {
+	for (uint_fast16_t i = 0; i < compiler->mono_clone_count; i++)
+		if (compiler->mono_clones[i].proc_id == proc_id) {
+			uint_fast8_t j = 0;
+			while (j < typearg_count && typecheck_types_eq(compiler->mono_clones[i].typeargs[j], typeargs[j]))
+				j++;
+			if (j == typearg_count)
+				return &compiler->mono_clones[i];
+		}
+	return NULL;
+}
+
+//the clone a generic proc call goes to, if its type arguments are concrete and the callee has been cloned for them
+static compiler_mono_clone_t* resolve_mono_clone(compiler_t* compiler, ast_value_t value) {
+	ast_proc_t* callee;
+	if (!compiler->mono_clone_count || !(callee = find_generic_callee(compiler, value)))
+		return NULL;
+
+	safe_gc_t temp_safe_gc;
+	typecheck_type_t typeargs[TYPE_MAX_SUBTYPES];
+	ESCAPE_ON_FAIL(init_safe_gc(&temp_safe_gc));
+	compiler_mono_clone_t* clone = mono_typeargs(compiler, value, &temp_safe_gc, typeargs) ? find_mono_clone(compiler, callee->id, typeargs, value.data.proc_call->procedure.type.type_id) : NULL;
+	free_safe_gc(&temp_safe_gc, 1);
+	return clone;
+}
+
+//the register a proc call goes through
+static compiler_reg_t call_proc_reg(compiler_t* compiler, ast_value_t value) {
+	compiler_mono_clone_t* clone = resolve_mono_clone(compiler, value);
+	return clone ? clone->proc_reg : compiler->eval_regs[value.data.proc_call->procedure.id];
+}
+
+//the proc a call's body is spliced in from, and the clone it's compiled as if the callee is generic
+static ast_proc_t* resolve_inline_callee(compiler_t* compiler, ast_value_t value, compiler_mono_clone_t** clone) {
+	ast_proc_t* callee = compiler->inline_callees[value.data.proc_call->id];
+	*clone = NULL;
+	if (callee && value.data.proc_call->procedure.type.type_id && !(*clone = resolve_mono_clone(compiler, value)))
+		return NULL; //generic procs are called if they haven't been cloned for the call's type arguments
+	return callee;
+}
+
 static int compile_value_free(compiler_t* compiler, ast_value_t value, ast_proc_t* proc) {
 	return compile_force_free(compiler, compiler->eval_regs[value.id], value.type, proc, value.free_status);
 }
 
+#define TAIL_CALL_NONE 0
+#define TAIL_CALL_SELF 1
+#define TAIL_CALL_OTHER 2
+
+//whether a returned proc call can reuse the current proc's stack frame, rather than pushing a new one
+static int tail_call_kind(compiler_t* compiler, ast_value_t value, ast_proc_t* proc) {
+	compiler_mono_clone_t* inline_clone;
+	if (!proc || compiler->inline_depth || value.value_type != AST_VALUE_PROC_CALL || !value.affects_state || value.trace_status == POSTPROC_SUPERTRACE_CHILDREN || resolve_inline_callee(compiler, value, &inline_clone))
+		return TAIL_CALL_NONE;
+	if (HAS_TYPEARGS(value.type))
+		for (uint_fast8_t i = 0; i < value.data.proc_call->procedure.type.type_id; i++)
+			if (value.data.proc_call->typeargs[i].type != TYPE_TYPEARG)
+				return TAIL_CALL_NONE; //atomized type signatures are popped after the call returns
+
+	//a generic proc calling itself with other type arguments goes to another clone
+	if (value.data.proc_call->procedure.value_type == AST_VALUE_VAR && value.data.proc_call->procedure.data.variable == proc->thisproc && resolve_mono_clone(compiler, value) == compiler->current_clone)
+		return (proc->do_gc || value.gc_status != POSTPROC_GC_LOCAL_DYNAMIC) ? TAIL_CALL_SELF : TAIL_CALL_NONE;
+	
+	//another proc's gc-frame can't be merged into this one's
+	return (!proc->do_gc && value.gc_status != POSTPROC_GC_LOCAL_DYNAMIC) ? TAIL_CALL_OTHER : TAIL_CALL_NONE;
+}
+
+//whether a code block returns a self tail call, not counting nested procs
+static int has_self_tail_call(compiler_t* compiler, ast_code_block_t code_block, ast_proc_t* proc) {
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+		if (code_block.instructions[i].type == AST_STATEMENT_RETURN_VALUE && tail_call_kind(compiler, code_block.instructions[i].data.value, proc) == TAIL_CALL_SELF)
+			return 1;
+		else if (code_block.instructions[i].type == AST_STATEMENT_COND)
+			for (ast_cond_t* conditional = code_block.instructions[i].data.conditional; conditional; conditional = conditional->next_if_false)
+				if (has_self_tail_call(compiler, conditional->exec_block, proc))
+					return 1;
+	return 0;
+}
+
+//evaluates a proc call's arguments and type arguments into the call's stack area
+static int compile_proc_call_args(compiler_t* compiler, ast_value_t value, ast_proc_t* proc, uint16_t* type_sigs_to_pop) {
+	for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++) {
+		ESCAPE_ON_FAIL(compile_value(compiler, value.data.proc_call->arguments[i], proc));
+		if (compiler->move_eval[value.data.proc_call->arguments[i].id])
+			EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, LOC_REG(compiler->proc_call_offsets[value.data.proc_call->id] + i + 1), compiler->eval_regs[value.data.proc_call->arguments[i].id]));
+	}
+	ESCAPE_ON_FAIL(compile_value(compiler, value.data.proc_call->procedure, proc));
+
+	//the callee's frame starts at the call's offset, and is only read by the callee itself if its body is inlined
+	compiler_mono_clone_t* inline_clone;
+	for (uint_fast16_t i = 0; !resolve_inline_callee(compiler, value, &inline_clone) && i <= value.data.proc_call->argument_count + value.data.proc_call->procedure.type.type_id; i++)
+		MARK_LOCAL(LOC_REG(compiler->proc_call_offsets[value.data.proc_call->id] + i), LOCAL_KIND_UNLOWERABLE);
+
+	*type_sigs_to_pop = 0;
+	if (value.data.proc_call->procedure.type.type_id) {
+		uint16_t gen_arg_reg = value.data.proc_call->argument_count + 1 + compiler->proc_call_offsets[value.data.proc_call->id];
+		for (uint_fast8_t i = 0; i < value.data.proc_call->procedure.type.type_id; i++) {
+			//if (value.data.proc_call->procedure.type.sub_types[i].type == TYPE_ANY) {
+			if (value.data.proc_call->typeargs[i].type == TYPE_TYPEARG && !compiler->current_clone)
+				EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, LOC_REG(gen_arg_reg++), TYPEARG_INFO_REG(value.data.proc_call->typeargs[i])))
+			else {
+				machine_type_sig_t* sig;
+				ESCAPE_ON_FAIL(sig = compiler_define_typesig(compiler, proc, value.data.proc_call->typeargs[i]))
+				if (HAS_TYPEARGS(value.type)) {
+					EMIT_INS(INS3(COMPILER_OP_CODE_SET, LOC_REG(gen_arg_reg++), GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(1)));
+					(*type_sigs_to_pop)++;
+				}
+				else
+					EMIT_INS(INS3(COMPILER_OP_CODE_SET, LOC_REG(gen_arg_reg++), GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(0)));
+			}
+			//}
+		}
+	}
+	return 1;
+}
+
+//whether every property of a record, including its base records' properties, is initialized whenever it's allocated
+static int record_fully_initialized(compiler_t* compiler, ast_record_proto_t* proto) {
+	for (;;) {
+		for (uint_fast8_t i = 0; i < proto->property_count; i++)
+			if (proto->properties[i].defer_init)
+				return 0;
+		if (!proto->base_record)
+			return 1;
+		proto = compiler->ast->record_protos[proto->base_record->type_id];
+	}
+}
+
+//compiles a proc's definition, or one of its clones, under the given proc register and id
+static int compile_proc(compiler_t* compiler, ast_value_t value, compiler_reg_t proc_reg, uint16_t id) {
+	uint32_t start_ip = compiler->ins_builder.instruction_count;
+	compiler->proc_label_ips[id] = start_ip;
+
+	//parameters, type arguments and the return value are shared with the caller
+	PANIC_ON_FAIL(compiler->proc_local_kinds[id] = safe_calloc(compiler->safe_gc, compiler->proc_call_max_locals[id] + 1, sizeof(uint8_t)), compiler, ERROR_MEMORY);
+	for (uint_fast16_t i = 0; i <= value.data.procedure->param_count + value.type.type_id && i <= compiler->proc_call_max_locals[id]; i++)
+		compiler->proc_local_kinds[id][i] = LOCAL_KIND_UNLOWERABLE;
+
+	EMIT_INS(INS1(COMPILER_OP_CODE_LABEL, proc_reg));
+	EMIT_INS(INS0(COMPILER_OP_CODE_JUMP));
+
+	compiler->ins_builder.instructions[start_ip].regs[1] = GLOB_REG(compiler->ins_builder.instruction_count);
+	EMIT_INS(INS1(COMPILER_OP_CODE_STACK_VALIDATE, GLOB_REG(compiler->proc_call_max_locals[id])));
+	if (value.data.procedure->do_gc)
+		EMIT_INS(INS0(COMPILER_OP_CODE_GC_NEW_FRAME));
+	compiler->proc_body_ips[id] = compiler->ins_builder.instruction_count;
+	compiler->proc_self_tail_calls[id] = value.data.procedure->do_gc && has_self_tail_call(compiler, value.data.procedure->exec_block, value.data.procedure);
+
+	uint16_t rc_proc_base = compiler->rc_proc_base, rc_loop_base = compiler->rc_loop_base;
+	compiler->rc_proc_base = compiler->rc_loop_base = compiler->rc_local_count;
+	ESCAPE_ON_FAIL(compile_code_block(compiler, value.data.procedure->exec_block, value.data.procedure, 0, NULL, 0));
+	compiler->rc_proc_base = rc_proc_base;
+	compiler->rc_loop_base = rc_loop_base;
+	compiler->ins_builder.instructions[start_ip + 1].regs[0] = GLOB_REG(compiler->ins_builder.instruction_count);
+	return 1;
+}
+
+//splices a small proc's body in place of a call to it, with its frame laid over the call's stack area like a real call's
+//returns jump past the spliced body, and are chained through their jump targets until its end is known
+static int compile_inline_call(compiler_t* compiler, ast_value_t value, ast_proc_t* proc) {
+	compiler_mono_clone_t* clone;
+	ast_proc_t* callee = resolve_inline_callee(compiler, value, &clone);
+	uint16_t call_offset = compiler->proc_call_offsets[value.data.proc_call->id];
+
+	uint16_t type_sigs_to_pop;
+	ESCAPE_ON_FAIL(compile_proc_call_args(compiler, value, proc, &type_sigs_to_pop));
+	PANIC_ON_FAIL(!type_sigs_to_pop, compiler, ERROR_INTERNAL);
+	if (!proc) //top level code has no stack validation of its own to cover the callee's locals
+		EMIT_INS(INS1(COMPILER_OP_CODE_STACK_VALIDATE, GLOB_REG(call_offset + compiler->proc_call_max_locals[callee->id])));
+
+	compiler_mono_clone_t* current_clone = compiler->current_clone;
+	uint16_t inline_offset = compiler->inline_offset;
+	uint16_t inline_frame = compiler->inline_frame;
+	uint32_t inline_returns = compiler->inline_returns;
+	uint32_t* inline_src_locs = compiler->inline_src_locs;
+	uint16_t rc_proc_base = compiler->rc_proc_base, rc_loop_base = compiler->rc_loop_base;
+
+	if (!compiler->inline_depth) {
+		compiler->inline_frame = proc ? PROC_ID(proc) : UINT16_MAX;
+		compiler->inline_offset = 0;
+	}
+	compiler->inline_depth++;
+	compiler->inline_offset += call_offset;
+	compiler->inline_returns = UINT32_MAX;
+	compiler->current_clone = clone;
+	compiler->rc_proc_base = compiler->rc_loop_base = compiler->rc_local_count;
+	PANIC_ON_FAIL(compiler->inline_src_locs = safe_malloc(compiler->safe_gc, compiler->ast->dbg_table->src_loc_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+	memset(compiler->inline_src_locs, 0xFF, compiler->ast->dbg_table->src_loc_count * sizeof(uint32_t));
+
+	ESCAPE_ON_FAIL(compile_code_block(compiler, callee->exec_block, callee, 0, NULL, 0));
+
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint32_t end_ip = compiler->ins_builder.instruction_count;
+	for (uint32_t return_ip = compiler->inline_returns; return_ip != UINT32_MAX;) {
+		uint32_t next_return_ip = instructions[return_ip].regs[0].reg;
+		if (return_ip == end_ip - 1) //the body's final return falls through instead
+			instructions[return_ip] = INS0(COMPILER_OP_CODE_NOP);
+		else
+			instructions[return_ip].regs[0] = GLOB_REG(end_ip);
+		return_ip = next_return_ip;
+	}
+
+	safe_free(compiler->safe_gc, compiler->inline_src_locs);
+	compiler->inline_depth--;
+	compiler->inline_src_locs = inline_src_locs;
+	compiler->inline_returns = inline_returns;
+	compiler->inline_frame = inline_frame;
+	compiler->inline_offset = inline_offset;
+	compiler->current_clone = current_clone;
+	compiler->rc_proc_base = rc_proc_base;
+	compiler->rc_loop_base = rc_loop_base;
+	return 1;
+}
+
 static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* proc) {
-	if (!value.affects_state)
+	if (!value.affects_state || compiler->hoisted_values[value.id])
 		return 1;
 
-	debug_loc_set_minip(compiler->ast->dbg_table, value.src_loc_id, compiler->ins_builder.instruction_count);
+	debug_loc_set_minip(compiler->ast->dbg_table, SRC_LOC(value.src_loc_id), compiler->ins_builder.instruction_count);
+	MARK_LOCAL(compiler->eval_regs[value.id], IS_PRIMITIVE(value.type) ? LOCAL_KIND_PRIMITIVE : LOCAL_KIND_UNLOWERABLE);
 
 	switch (value.value_type)
 	{
 	case AST_VALUE_ALLOC_ARRAY: {
 		ESCAPE_ON_FAIL(compile_value(compiler, value.data.alloc_array->size, proc));
-		if (value.data.alloc_array->elem_type->type == TYPE_TYPEARG) {
+		if (value.data.alloc_array->elem_type->type == TYPE_TYPEARG && !compiler->current_clone) {
 			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC, compiler->eval_regs[value.id], compiler->eval_regs[value.data.alloc_array->size.id], GLOB_REG(GC_TRACE_MODE_NONE)));
 			EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_CONF_ALL, compiler->eval_regs[value.id], TYPEARG_INFO_REG(*value.data.alloc_array->elem_type)));
 		}
 		else
-			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC, compiler->eval_regs[value.id], compiler->eval_regs[value.data.alloc_array->size.id], GLOB_REG(IS_REF_TYPE(*value.data.alloc_array->elem_type))));
+			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC, compiler->eval_regs[value.id], compiler->eval_regs[value.data.alloc_array->size.id], GLOB_REG(IS_REF_TYPE(mono_type(compiler, *value.data.alloc_array->elem_type)))));
 
 		machine_type_sig_t* sig;
 		ESCAPE_ON_FAIL(sig = compiler_define_typesig(compiler, proc, value.type));
-		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(typecheck_has_type(value.type, TYPE_TYPEARG))));
+		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(HAS_TYPEARGS(value.type))));
 		break;
 	}
 	case AST_VALUE_ARRAY_LITERAL: {
-		if (value.data.array_literal.elem_type->type == TYPE_TYPEARG) {
+		if (value.data.array_literal.elem_type->type == TYPE_TYPEARG && !compiler->current_clone) {
 			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC_I, compiler->eval_regs[value.id], GLOB_REG(value.data.array_literal.element_count), GLOB_REG(GC_TRACE_MODE_NONE)));
 			EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_CONF_ALL, compiler->eval_regs[value.id], TYPEARG_INFO_REG(*value.data.array_literal.elem_type)));
 		}
 		else
-			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC_I, compiler->eval_regs[value.id], GLOB_REG(value.data.array_literal.element_count), GLOB_REG(IS_REF_TYPE(*value.data.array_literal.elem_type))));
+			EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC_I, compiler->eval_regs[value.id], GLOB_REG(value.data.array_literal.element_count), GLOB_REG(IS_REF_TYPE(mono_type(compiler, *value.data.array_literal.elem_type)))));
 
 		machine_type_sig_t* sig;
 		ESCAPE_ON_FAIL(sig = compiler_define_typesig(compiler, proc, value.type));
-		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(typecheck_has_type(value.type, TYPE_TYPEARG))));
+		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(HAS_TYPEARGS(value.type))));
 
 		for (uint_fast32_t i = 0; i < value.data.array_literal.element_count; i++) {
 			ESCAPE_ON_FAIL(compile_value(compiler, value.data.array_literal.elements[i], proc));
@@ -287,20 +1318,16 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 		break;
 	}
 	case AST_VALUE_ALLOC_RECORD: {
-		EMIT_INS(INS3(COMPILER_OP_CODE_ALLOC_I, compiler->eval_regs[value.id], GLOB_REG(value.data.alloc_record.proto->index_offset + value.data.alloc_record.proto->property_count), GLOB_REG(value.data.alloc_record.proto->do_gc ? GC_TRACE_MODE_SOME : GC_TRACE_MODE_NONE)));
+		//untraced records whose properties are all initialized by their constructor never have their init status read
+		EMIT_INS(INS3((!value.data.alloc_record.proto->do_gc && record_fully_initialized(compiler, value.data.alloc_record.proto)) ? COMPILER_OP_CODE_ALLOC_I_INIT : COMPILER_OP_CODE_ALLOC_I, compiler->eval_regs[value.id], GLOB_REG(value.data.alloc_record.proto->index_offset + value.data.alloc_record.proto->property_count), GLOB_REG(value.data.alloc_record.proto->do_gc ? GC_TRACE_MODE_SOME : GC_TRACE_MODE_NONE)));
 
 		machine_type_sig_t* sig;
 		ESCAPE_ON_FAIL(sig = compiler_define_typesig(compiler, proc, value.type));
-		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(typecheck_has_type(value.type, TYPE_TYPEARG))));
+		EMIT_INS(INS3(COMPILER_OP_CODE_CONFIG_TYPESIG, compiler->eval_regs[value.id], GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(HAS_TYPEARGS(value.type))));
 
 		//if (value.data.alloc_record.do_typeguard)
 		//	EMIT_INS(INS1(COMPILER_OP_CODE_CONFIG_TYPEGUARD, compiler->eval_regs[value.id]));
 
-		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++) {
-			ESCAPE_ON_FAIL(compile_value(compiler, value.data.alloc_record.init_values[i].value, proc));
-			EMIT_INS(INS3(COMPILER_OP_CODE_STORE_ALLOC_I, compiler->eval_regs[value.id], compiler->eval_regs[value.data.alloc_record.init_values[i].value.id], GLOB_REG(value.data.alloc_record.init_values[i].property->id)));
-		}
-
 		ast_record_proto_t* current_proto = value.data.alloc_record.proto;
 		for (;;) {
 			for (uint_fast8_t i = 0; i < current_proto->property_count; i++) {
@@ -308,6 +1335,8 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 				if (value.data.alloc_record.proto->do_gc) {
 					if (value.data.alloc_record.typearg_traces[current_proto->properties[i].id] == POSTPROC_TRACE_CHILDREN)
 						EMIT_INS(INS3(COMPILER_OP_CODE_CONF_TRACE, compiler->eval_regs[value.id], GLOB_REG(current_proto->properties[i].id), GLOB_REG(GC_TRACE_MODE_ALL)))
+					else if (value.data.alloc_record.typearg_traces[current_proto->properties[i].id] == POSTPROC_TRACE_DYNAMIC && compiler->current_clone)
+						EMIT_INS(INS3(COMPILER_OP_CODE_CONF_TRACE, compiler->eval_regs[value.id], GLOB_REG(current_proto->properties[i].id), GLOB_REG(IS_REF_TYPE(mono_type(compiler, current_proto->properties[i].type)))))
 					else if (value.data.alloc_record.typearg_traces[current_proto->properties[i].id] == POSTPROC_TRACE_DYNAMIC)
 						EMIT_INS(INS3(COMPILER_OP_CODE_DYNAMIC_CONF, compiler->eval_regs[value.id], GLOB_REG(current_proto->properties[i].id), TYPEARG_INFO_REG(current_proto->properties[i].type)))
 					else
@@ -321,25 +1350,34 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 				current_proto = compiler->ast->record_protos[current_proto->base_record->type_id];
 			else break;
 		}
+
+		//properties are initialized after their traces are configured, so every store sees whether it's writing a traced property
+		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++) {
+			ESCAPE_ON_FAIL(compile_value(compiler, value.data.alloc_record.init_values[i].value, proc));
+			EMIT_INS(INS3(COMPILER_OP_CODE_STORE_ALLOC_I, compiler->eval_regs[value.id], compiler->eval_regs[value.data.alloc_record.init_values[i].value.id], GLOB_REG(value.data.alloc_record.init_values[i].property->id)));
+		}
 		break;
 	}
-	case AST_VALUE_PROC: {
-		uint16_t start_ip = compiler->ins_builder.instruction_count;
+	case AST_VALUE_PROC:
+		ESCAPE_ON_FAIL(compile_proc(compiler, value, compiler->eval_regs[value.id], value.data.procedure->id));
 
-		EMIT_INS(INS1(COMPILER_OP_CODE_LABEL, compiler->eval_regs[value.id]));
-		EMIT_INS(INS0(COMPILER_OP_CODE_JUMP));
+		//clones are defined right after their generic proc, so they're defined wherever it is
+		for (uint_fast16_t i = 0; i < compiler->mono_clone_count; i++)
+			if (compiler->mono_clones[i].proc_id == value.data.procedure->id) {
+				compiler->current_clone = &compiler->mono_clones[i];
+				PANIC_ON_FAIL(compiler->current_clone->src_locs = safe_malloc(compiler->safe_gc, compiler->ast->dbg_table->src_loc_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+				memset(compiler->current_clone->src_locs, 0xFF, compiler->ast->dbg_table->src_loc_count * sizeof(uint32_t));
 
-		compiler->ins_builder.instructions[start_ip].regs[1] = GLOB_REG(compiler->ins_builder.instruction_count);
-		EMIT_INS(INS1(COMPILER_OP_CODE_STACK_VALIDATE, GLOB_REG(compiler->proc_call_max_locals[value.data.procedure->id])));
-		if (value.data.procedure->do_gc)
-			EMIT_INS(INS0(COMPILER_OP_CODE_GC_NEW_FRAME));
-
-		compile_code_block(compiler, value.data.procedure->exec_block, value.data.procedure, 0, NULL, 0);
-		compiler->ins_builder.instructions[start_ip + 1].regs[0] = GLOB_REG(compiler->ins_builder.instruction_count);
+				ESCAPE_ON_FAIL(compile_proc(compiler, value, compiler->current_clone->proc_reg, compiler->current_clone->id));
+				safe_free(compiler->safe_gc, compiler->current_clone->src_locs);
+				compiler->current_clone = NULL;
+			}
 		break;
-	}
 	case AST_VALUE_SET_VAR:
 		if (value.data.set_var->var_info->is_used) {
+			//a value evaluated straight into the variable's register overwrites its old one without freeing it
+			if (compiler->rc_mode && !compiler->move_eval[value.data.set_var->set_value.id] && IS_REF_TYPE(mono_type(compiler, value.data.set_var->var_info->type)))
+				EMIT_INS(INS1(COMPILER_OP_CODE_RC_RELEASE, compiler->var_regs[value.data.set_var->var_info->id]));
 			ESCAPE_ON_FAIL(compile_value(compiler, value.data.set_var->set_value, proc));
 			if (compiler->move_eval[value.data.set_var->set_value.id]) {
 				ESCAPE_ON_FAIL(compile_force_free(compiler, compiler->var_regs[value.data.set_var->var_info->id], value.data.set_var->var_info->type, proc, value.data.set_var->var_info->type.type == TYPE_TYPEARG ? POSTPROC_FREE_DYNAMIC : IS_REF_TYPE(value.data.set_var->var_info->type) ? POSTPROC_FREE : POSTPROC_FREE_NONE));
@@ -419,7 +1457,8 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 		break;
 	case AST_VALUE_GET_PROP:
 		ESCAPE_ON_FAIL(compile_value(compiler, value.data.get_prop->record, proc));
-		EMIT_INS(INS3(COMPILER_OP_CODE_LOAD_ALLOC_I, compiler->eval_regs[value.data.get_prop->record.id], compiler->eval_regs[value.id], GLOB_REG(value.data.get_prop->property->id)));
+		//properties that aren't deferinit are initialized by every constructor, so reading them can't fail
+		EMIT_INS(INS3(value.data.get_prop->property->defer_init ? COMPILER_OP_CODE_LOAD_ALLOC_I : COMPILER_OP_CODE_LOAD_ALLOC_I_INIT, compiler->eval_regs[value.data.get_prop->record.id], compiler->eval_regs[value.id], GLOB_REG(value.data.get_prop->property->id)));
 		ESCAPE_ON_FAIL(compile_value_free(compiler, value.data.get_prop->record, proc));
 		break;
 	case AST_VALUE_BINARY_OP: {
@@ -464,6 +1503,12 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 			}
 			else
 				EMIT_INS(INS1(COMPILER_OP_CODE_LONG_INCREMENT + type_offset + op_offset, compiler->eval_regs[value.data.unary_op->operand.id]));
+
+			//products of an induction variable hoisted out of the loops it's stepped in are stepped along with it
+			if (stepped_var(value))
+				for (uint_fast16_t i = 0; i < compiler->loop_hoist_count; i++)
+					if (compiler->loop_hoists[i].active && compiler->loop_hoists[i].induction_var == stepped_var(value))
+						EMIT_INS(INS3(COMPILER_OP_CODE_LONG_ADD + op_offset, compiler->eval_regs[compiler->loop_hoists[i].value.id], compiler->eval_regs[compiler->loop_hoists[i].step->id], compiler->eval_regs[compiler->loop_hoists[i].value.id]));
 		}
 
 		ESCAPE_ON_FAIL(compile_value_free(compiler, value.data.unary_op->operand, proc));
@@ -504,35 +1549,16 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 		break;
 	}
 	case AST_VALUE_PROC_CALL: {
-		for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++) {
-			ESCAPE_ON_FAIL(compile_value(compiler, value.data.proc_call->arguments[i], proc));
-			if (compiler->move_eval[value.data.proc_call->arguments[i].id])
-				EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, LOC_REG(compiler->proc_call_offsets[value.data.proc_call->id] + i + 1), compiler->eval_regs[value.data.proc_call->arguments[i].id]));
-		}
-		ESCAPE_ON_FAIL(compile_value(compiler, value.data.proc_call->procedure, proc));
-
-		uint16_t type_sigs_to_pop = 0;
-		if (value.data.proc_call->procedure.type.type_id) {
-			uint16_t gen_arg_reg = value.data.proc_call->argument_count + 1 + compiler->proc_call_offsets[value.data.proc_call->id];
-			for (uint_fast8_t i = 0; i < value.data.proc_call->procedure.type.type_id; i++) {
-				//if (value.data.proc_call->procedure.type.sub_types[i].type == TYPE_ANY) {
-				if (value.data.proc_call->typeargs[i].type == TYPE_TYPEARG)
-					EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, LOC_REG(gen_arg_reg++), TYPEARG_INFO_REG(value.data.proc_call->typeargs[i])))
-				else {
-					machine_type_sig_t* sig;
-					ESCAPE_ON_FAIL(sig = compiler_define_typesig(compiler, proc, value.data.proc_call->typeargs[i]))
-					if (typecheck_has_type(value.type, TYPE_TYPEARG)) {
-						EMIT_INS(INS3(COMPILER_OP_CODE_SET, LOC_REG(gen_arg_reg++), GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(1)));
-						type_sigs_to_pop++;
-					}
-					else
-						EMIT_INS(INS3(COMPILER_OP_CODE_SET, LOC_REG(gen_arg_reg++), GLOB_REG(sig - compiler->target_machine->defined_signatures), GLOB_REG(0)));
-				}
-				//}
-			}
+		compiler_mono_clone_t* inline_clone;
+		if (resolve_inline_callee(compiler, value, &inline_clone)) {
+			ESCAPE_ON_FAIL(compile_inline_call(compiler, value, proc));
+			break;
 		}
 
-		EMIT_INS(INS2(COMPILER_OP_CODE_CALL, compiler->eval_regs[value.data.proc_call->procedure.id], GLOB_REG(compiler->proc_call_offsets[value.data.proc_call->id])));
+		uint16_t type_sigs_to_pop;
+		ESCAPE_ON_FAIL(compile_proc_call_args(compiler, value, proc, &type_sigs_to_pop));
+
+		EMIT_INS(INS2(COMPILER_OP_CODE_CALL, call_proc_reg(compiler, value), GLOB_REG(compiler->proc_call_offsets[value.data.proc_call->id])));
 		if (type_sigs_to_pop)
 			EMIT_INS(INS1(COMPILER_OP_CODE_POP_ATOM_TYPESIGS, GLOB_REG(type_sigs_to_pop)));
 		if (compiler->proc_call_offsets[value.data.proc_call->id])
@@ -556,29 +1582,68 @@ static int compile_value(compiler_t* compiler, ast_value_t value, ast_proc_t* pr
 		EMIT_INS(INS2(COMPILER_OP_CODE_GC_TRACE, compiler->eval_regs[value.id], GLOB_REG(1)))
 	}
 	else if (value.trace_status == POSTPROC_TRACE_DYNAMIC && (proc && proc->do_gc))
-		EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_TRACE, compiler->eval_regs[value.id], TYPEARG_INFO_REG(value.type)));
+		ESCAPE_ON_FAIL(compile_dynamic_trace(compiler, compiler->eval_regs[value.id], value.type, proc));
+
+	debug_loc_set_maxip(compiler->ast->dbg_table, SRC_LOC(value.src_loc_id), compiler->ins_builder.instruction_count);
+	return 1;
+}
+
+//moves a tail call's arguments over the current proc's, and jumps into the callee without pushing a return position
+//a self tail call jumps past the proc's stack validation and gc-frame setup, so the iterations share one gc-frame
+static int compile_tail_call(compiler_t* compiler, ast_value_t value, ast_proc_t* proc) {
+	debug_loc_set_minip(compiler->ast->dbg_table, SRC_LOC(value.src_loc_id), compiler->ins_builder.instruction_count);
+
+	uint16_t type_sigs_to_pop;
+	ESCAPE_ON_FAIL(compile_proc_call_args(compiler, value, proc, &type_sigs_to_pop));
+	PANIC_ON_FAIL(!type_sigs_to_pop, compiler, ERROR_INTERNAL);
+
+	uint16_t call_offset = compiler->proc_call_offsets[value.data.proc_call->id];
+	uint16_t arg_count = value.data.proc_call->argument_count + value.data.proc_call->procedure.type.type_id;
+	if (tail_call_kind(compiler, value, proc) == TAIL_CALL_SELF) {
+		for (uint_fast16_t i = 0; i < arg_count; i++)
+			EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, LOC_REG(i + 1), LOC_REG(call_offset + i + 1)));
+		EMIT_INS(INS1(COMPILER_OP_CODE_JUMP, GLOB_REG(compiler->proc_body_ips[PROC_ID(proc)])));
+	}
+	else
+		EMIT_INS(INS3(COMPILER_OP_CODE_TAIL_CALL, call_proc_reg(compiler, value), GLOB_REG(call_offset), GLOB_REG(arg_count)));
 
-	debug_loc_set_maxip(compiler->ast->dbg_table, value.src_loc_id, compiler->ins_builder.instruction_count);
+	debug_loc_set_maxip(compiler->ast->dbg_table, SRC_LOC(value.src_loc_id), compiler->ins_builder.instruction_count);
 	return 1;
 }
 
-static int compile_conditional(compiler_t* compiler, ast_cond_t* conditional, ast_proc_t* proc, uint16_t continue_ip, uint16_t* break_jumps, uint8_t* break_jump_top) {
+static int compile_conditional(compiler_t* compiler, ast_cond_t* conditional, ast_proc_t* proc, uint32_t continue_ip, uint32_t* break_jumps, uint8_t* break_jump_top) {
 	if (conditional->next_if_true) {
-		uint16_t this_continue_ip = compiler->ins_builder.instruction_count;
+		//values hoisted out of the loop are evaluated once before it's entered
+		for (uint_fast16_t i = 0; i < compiler->loop_hoist_count; i++)
+			if (compiler->loop_hoists[i].loop == conditional) {
+				compiler->hoisted_values[compiler->loop_hoists[i].value.id] = 0;
+				ESCAPE_ON_FAIL(compile_value(compiler, compiler->loop_hoists[i].value, proc));
+				compiler->hoisted_values[compiler->loop_hoists[i].value.id] = 1;
+				compiler->loop_hoists[i].active = 1;
+			}
+
+		uint32_t this_continue_ip = compiler->ins_builder.instruction_count;
 		ESCAPE_ON_FAIL(compile_value(compiler, *conditional->condition, proc));
-		uint16_t this_break_ip = compiler->ins_builder.instruction_count;
+		uint32_t this_break_ip = compiler->ins_builder.instruction_count;
 
-		static uint16_t lp_break_jumps[64];
+		static uint32_t lp_break_jumps[64];
 		uint8_t lp_break_jump_count = 0;
 
 		EMIT_INS(INS1(COMPILER_OP_CODE_JUMP_CHECK, compiler->eval_regs[conditional->condition->id]));
 		ESCAPE_ON_FAIL(compile_value_free(compiler, *conditional->condition, proc));
+		uint16_t rc_loop_base = compiler->rc_loop_base;
+		compiler->rc_loop_base = compiler->rc_local_count;
 		ESCAPE_ON_FAIL(compile_code_block(compiler, conditional->exec_block, proc, this_continue_ip, lp_break_jumps, &lp_break_jump_count));
+		compiler->rc_loop_base = rc_loop_base;
 		EMIT_INS(INS1(COMPILER_OP_CODE_JUMP, GLOB_REG(this_continue_ip)));
 		compiler->ins_builder.instructions[this_break_ip].regs[1] = GLOB_REG(compiler->ins_builder.instruction_count);
 		ESCAPE_ON_FAIL(compile_value_free(compiler, *conditional->condition, proc));
 		for (uint_fast8_t i = 0; i < lp_break_jump_count; i++)
 			compiler->ins_builder.instructions[lp_break_jumps[i]].regs[0] = GLOB_REG(compiler->ins_builder.instruction_count);
+
+		for (uint_fast16_t i = 0; i < compiler->loop_hoist_count; i++)
+			if (compiler->loop_hoists[i].loop == conditional)
+				compiler->loop_hoists[i].active = 0;
 	}
 	else {
 		uint16_t escape_jump_count = 0;
@@ -588,13 +1653,13 @@ static int compile_conditional(compiler_t* compiler, ast_cond_t* conditional, as
 				escape_jump_count++;
 		}
 
-		uint16_t* escape_jumps = safe_malloc(compiler->safe_gc, escape_jump_count * sizeof(uint16_t));
+		uint32_t* escape_jumps = safe_malloc(compiler->safe_gc, escape_jump_count * sizeof(uint32_t));
 		PANIC_ON_FAIL(escape_jumps, compiler, ERROR_MEMORY);
 		uint16_t current_escape_jump = 0;
 		while (conditional) {
 			if (conditional->condition) {
 				ESCAPE_ON_FAIL(compile_value(compiler, *conditional->condition, proc));
-				uint16_t move_next_ip = compiler->ins_builder.instruction_count;
+				uint32_t move_next_ip = compiler->ins_builder.instruction_count;
 				EMIT_INS(INS1(COMPILER_OP_CODE_JUMP_CHECK, compiler->eval_regs[conditional->condition->id]));
 				ESCAPE_ON_FAIL(compile_value_free(compiler, *conditional->condition, proc));
 				ESCAPE_ON_FAIL(compile_code_block(compiler, conditional->exec_block, proc, continue_ip, break_jumps, break_jump_top));
@@ -616,15 +1681,26 @@ static int compile_conditional(compiler_t* compiler, ast_cond_t* conditional, as
 	return 1;
 }
 
-static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block, ast_proc_t* proc, uint16_t continue_ip, uint16_t* break_jumps, uint8_t* break_jump_top) {
+static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block, ast_proc_t* proc, uint32_t continue_ip, uint32_t* break_jumps, uint8_t* break_jump_top) {
+	uint16_t rc_block_base = compiler->rc_local_count;
 	for (ast_statement_t* current_statement = code_block.instructions; current_statement != &code_block.instructions[code_block.instruction_count]; current_statement++) {
-		debug_loc_set_minip(compiler->ast->dbg_table, current_statement->src_loc_id, compiler->ins_builder.instruction_count);
+		debug_loc_set_minip(compiler->ast->dbg_table, SRC_LOC(current_statement->src_loc_id), compiler->ins_builder.instruction_count);
+
+		//locals are also released where their scopes are left early
+		if (current_statement->type == AST_STATEMENT_RETURN_VALUE || current_statement->type == AST_STATEMENT_RETURN)
+			ESCAPE_ON_FAIL(release_rc_locals(compiler, compiler->rc_proc_base))
+		else if (current_statement->type == AST_STATEMENT_BREAK || current_statement->type == AST_STATEMENT_CONTINUE)
+			ESCAPE_ON_FAIL(release_rc_locals(compiler, compiler->rc_loop_base));
+
 		switch (current_statement->type) {
 		case AST_STATEMENT_DECL_VAR:
 			if (current_statement->data.var_decl.var_info->is_used) {
+				MARK_LOCAL(compiler->var_regs[current_statement->data.var_decl.var_info->id], IS_PRIMITIVE(current_statement->data.var_decl.var_info->type) ? LOCAL_KIND_PRIMITIVE : LOCAL_KIND_UNLOWERABLE);
 				ESCAPE_ON_FAIL(compile_value(compiler, current_statement->data.var_decl.set_value, proc));
 				if (compiler->move_eval[current_statement->data.var_decl.set_value.id])
 					EMIT_INS(INS2(COMPILER_OP_CODE_MOVE, compiler->var_regs[current_statement->data.var_decl.var_info->id], compiler->eval_regs[current_statement->data.var_decl.set_value.id]));
+				if (compiler->rc_mode && IS_REF_TYPE(mono_type(compiler, current_statement->data.var_decl.var_info->type)))
+					ESCAPE_ON_FAIL(push_rc_local(compiler, compiler->var_regs[current_statement->data.var_decl.var_info->id]));
 			}
 			else if (current_statement->data.var_decl.set_value.affects_state)
 				ESCAPE_ON_FAIL(compile_value(compiler, current_statement->data.var_decl.set_value, proc));
@@ -637,6 +1713,10 @@ static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block,
 			ESCAPE_ON_FAIL(compile_value_free(compiler, current_statement->data.value, proc));
 			break;
 		case AST_STATEMENT_RETURN_VALUE: {
+			if (tail_call_kind(compiler, current_statement->data.value, proc) != TAIL_CALL_NONE) {
+				ESCAPE_ON_FAIL(compile_tail_call(compiler, current_statement->data.value, proc));
+				break;
+			}
 			ESCAPE_ON_FAIL(compile_value(compiler, current_statement->data.value, proc));
 			compiler_reg_t src_reg = compiler->eval_regs[current_statement->data.value.id];
 			if (compiler->move_eval[current_statement->data.value.id] && !(!src_reg.reg && src_reg.offset))
@@ -644,9 +1724,22 @@ static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block,
 			if (current_statement->data.value.gc_status == POSTPROC_GC_LOCAL_ALLOC)
 				EMIT_INS(INS1(COMPILER_OP_CODE_GC_TRACE, LOC_REG(0)))
 			else if (current_statement->data.value.gc_status == POSTPROC_GC_LOCAL_DYNAMIC)
-				EMIT_INS(INS2(COMPILER_OP_CODE_DYNAMIC_TRACE, LOC_REG(0), TYPEARG_INFO_REG(current_statement->data.value.type)));
+				ESCAPE_ON_FAIL(compile_dynamic_trace(compiler, LOC_REG(0), current_statement->data.value.type, proc))
+			else if (compiler->proc_self_tail_calls[PROC_ID(proc)] && current_statement->data.value.trace_status == POSTPROC_TRACE_NONE) {
+				//parameters may have been allocated by an earlier self tail call, in this proc's own gc-frame
+				if (IS_REF_TYPE(current_statement->data.value.type))
+					EMIT_INS(INS1(COMPILER_OP_CODE_GC_TRACE, LOC_REG(0)))
+				else if (current_statement->data.value.type.type == TYPE_TYPEARG)
+					ESCAPE_ON_FAIL(compile_dynamic_trace(compiler, LOC_REG(0), current_statement->data.value.type, proc));
+			}
 		}
 		case AST_STATEMENT_RETURN:
+			if (compiler->inline_depth) {
+				uint32_t return_ip = compiler->ins_builder.instruction_count;
+				EMIT_INS(INS1(COMPILER_OP_CODE_JUMP, GLOB_REG(compiler->inline_returns)));
+				compiler->inline_returns = return_ip;
+				break;
+			}
 			if (proc->do_gc)
 				EMIT_INS(INS0(COMPILER_OP_CODE_GC_CLEAN));
 			EMIT_INS(INS0(COMPILER_OP_CODE_RETURN));
@@ -664,7 +1757,7 @@ static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block,
 			EMIT_INS(INS1(COMPILER_OP_CODE_ABORT, GLOB_REG(ERROR_ABORT)));
 			break;
 		case AST_STATEMENT_RECORD_PROTO:
-			if (current_statement->data.record_proto->base_record) {
+			if (current_statement->data.record_proto->base_record && current_statement->data.record_proto->is_used) { //records that are never allocated need no supertype signature
 				ast_record_proto_t* record = current_statement->data.record_proto;
 
 				machine_type_sig_t* super_sig;
@@ -673,24 +1766,171 @@ static int compile_code_block(compiler_t* compiler, ast_code_block_t code_block,
 			}
 			break;
 		}
-		debug_loc_set_maxip(compiler->ast->dbg_table, current_statement->src_loc_id, compiler->ins_builder.instruction_count);
+		debug_loc_set_maxip(compiler->ast->dbg_table, SRC_LOC(current_statement->src_loc_id), compiler->ins_builder.instruction_count);
 	}
+
+	//blocks that end by jumping out have already released their locals, and the program's own locals live until it exits
+	if (code_block.instruction_count && code_block.instructions != compiler->ast->exec_block.instructions) {
+		enum ast_statement_type last_type = code_block.instructions[code_block.instruction_count - 1].type;
+		if (last_type != AST_STATEMENT_RETURN_VALUE && last_type != AST_STATEMENT_RETURN && last_type != AST_STATEMENT_BREAK && last_type != AST_STATEMENT_CONTINUE && last_type != AST_STATEMENT_ABORT)
+			ESCAPE_ON_FAIL(release_rc_locals(compiler, rc_block_base));
+	}
+	compiler->rc_local_count = rc_block_base;
 	return 1;
 }
 
-int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine, ast_t* ast) {
+//clones a generic proc for a call's concrete type arguments, unless it's already been cloned for them or has reached the clone limit
+static int add_mono_clone(compiler_t* compiler, ast_proc_t* callee, typecheck_type_t* typeargs, uint8_t typearg_count) {
+	if (find_mono_clone(compiler, callee->id, typeargs, typearg_count))
+		return 1;
+
+	uint16_t clone_count = 0;
+	for (uint_fast16_t i = 0; i < compiler->mono_clone_count; i++)
+		if (compiler->mono_clones[i].proc_id == callee->id)
+			clone_count++;
+	if (clone_count == compiler->mono_limit || compiler->mono_clone_count == compiler->alloced_mono_clones || compiler->ast->proc_count + compiler->mono_clone_count == UINT16_MAX)
+		return 1; //calls fall back to the shared generic proc
+
+	compiler_mono_clone_t* clone = &compiler->mono_clones[compiler->mono_clone_count];
+	clone->proc_id = callee->id;
+	clone->id = compiler->ast->proc_count + compiler->mono_clone_count;
+	clone->proc_reg = GLOB_REG(compiler->ast->constant_count + compiler->current_global++);
+	PANIC_ON_FAIL(clone->typeargs = safe_malloc(compiler->safe_gc, typearg_count * sizeof(typecheck_type_t)), compiler, ERROR_MEMORY);
+	for (uint_fast8_t i = 0; i < typearg_count; i++)
+		PANIC_ON_FAIL(copy_typecheck_type(compiler->safe_gc, &clone->typeargs[i], typeargs[i]), compiler, ERROR_MEMORY);
+	compiler->mono_clone_count++;
+	return 1;
+}
+
+static int find_mono_clones(compiler_t* compiler, ast_code_block_t code_block);
+
+//finds the calls to generic procs with concrete type arguments, including those made by clones
+static int find_value_mono_clones(compiler_t* compiler, ast_value_t value) {
+	if (!value.affects_state)
+		return 1;
+	switch (value.value_type)
+	{
+	case AST_VALUE_ALLOC_ARRAY:
+		return find_value_mono_clones(compiler, value.data.alloc_array->size);
+	case AST_VALUE_ARRAY_LITERAL:
+		for (uint_fast16_t i = 0; i < value.data.array_literal.element_count; i++)
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.array_literal.elements[i]));
+		return 1;
+	case AST_VALUE_ALLOC_RECORD:
+		for (uint_fast16_t i = 0; i < value.data.alloc_record.init_value_count; i++)
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.alloc_record.init_values[i].value));
+		return 1;
+	case AST_VALUE_PROC:
+		return find_mono_clones(compiler, value.data.procedure->exec_block);
+	case AST_VALUE_SET_VAR:
+		return find_value_mono_clones(compiler, value.data.set_var->set_value);
+	case AST_VALUE_SET_INDEX:
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.set_index->array));
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.set_index->index));
+		return find_value_mono_clones(compiler, value.data.set_index->value);
+	case AST_VALUE_SET_PROP:
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.set_prop->record));
+		return find_value_mono_clones(compiler, value.data.set_prop->value);
+	case AST_VALUE_GET_INDEX:
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.get_index->array));
+		return find_value_mono_clones(compiler, value.data.get_index->index);
+	case AST_VALUE_GET_PROP:
+		return find_value_mono_clones(compiler, value.data.get_prop->record);
+	case AST_VALUE_BINARY_OP:
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.binary_op->lhs));
+		return find_value_mono_clones(compiler, value.data.binary_op->rhs);
+	case AST_VALUE_UNARY_OP:
+		return find_value_mono_clones(compiler, value.data.unary_op->operand);
+	case AST_VALUE_TYPE_OP:
+		return find_value_mono_clones(compiler, value.data.type_op->operand);
+	case AST_VALUE_FOREIGN:
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.foreign->op_id));
+		if (value.data.foreign->input)
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, *value.data.foreign->input));
+		return 1;
+	case AST_VALUE_PROC_CALL: {
+		for (uint_fast8_t i = 0; i < value.data.proc_call->argument_count; i++)
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.proc_call->arguments[i]));
+		ESCAPE_ON_FAIL(find_value_mono_clones(compiler, value.data.proc_call->procedure));
+
+		//procs that define procs aren't cloned, since the procs they define are only compiled once
+		ast_proc_t* callee = find_generic_callee(compiler, value);
+		if (!callee || compiler->proc_nests_procs[callee->id])
+			return 1;
+
+		safe_gc_t temp_safe_gc;
+		typecheck_type_t typeargs[TYPE_MAX_SUBTYPES];
+		PANIC_ON_FAIL(init_safe_gc(&temp_safe_gc), compiler, ERROR_MEMORY);
+		if (mono_typeargs(compiler, value, &temp_safe_gc, typeargs) && !add_mono_clone(compiler, callee, typeargs, value.data.proc_call->procedure.type.type_id)) {
+			free_safe_gc(&temp_safe_gc, 1);
+			return 0;
+		}
+		free_safe_gc(&temp_safe_gc, 1);
+		return 1;
+	}
+	}
+	return 1;
+}
+
+static int find_mono_clones(compiler_t* compiler, ast_code_block_t code_block) {
+	for (uint_fast32_t i = 0; i < code_block.instruction_count; i++)
+		switch (code_block.instructions[i].type)
+		{
+		case AST_STATEMENT_DECL_VAR:
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, code_block.instructions[i].data.var_decl.set_value));
+			break;
+		case AST_STATEMENT_COND:
+			for (ast_cond_t* conditional = code_block.instructions[i].data.conditional; conditional; conditional = conditional->next_if_false) {
+				if (conditional->condition)
+					ESCAPE_ON_FAIL(find_value_mono_clones(compiler, *conditional->condition));
+				ESCAPE_ON_FAIL(find_mono_clones(compiler, conditional->exec_block));
+			}
+			break;
+		case AST_STATEMENT_VALUE:
+		case AST_STATEMENT_RETURN_VALUE:
+			ESCAPE_ON_FAIL(find_value_mono_clones(compiler, code_block.instructions[i].data.value));
+			break;
+		}
+	return 1;
+}
+
+int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine, ast_t* ast, uint16_t mono_limit, uint16_t inline_limit, int optimize_loops, int compact_frames, int rc_mode) {
 	compiler->target_machine = target_machine;
 	compiler->safe_gc = safe_gc;
 	compiler->ast = ast;
 	compiler->last_err = ERROR_NONE;
 	compiler->current_global = 0;
+	compiler->proc_count = ast->proc_count;
+	compiler->mono_clones = NULL;
+	compiler->current_clone = NULL;
+	compiler->mono_clone_count = 0;
+	compiler->alloced_mono_clones = (ast->proc_count * mono_limit > UINT16_MAX) ? UINT16_MAX : ast->proc_count * mono_limit;
+	compiler->mono_limit = mono_limit;
+	compiler->inline_limit = inline_limit;
+	compiler->inline_depth = 0;
+	compiler->optimize_loops = optimize_loops;
+	compiler->compact_frames = compact_frames;
+	compiler->loop_hoist_count = 0;
+	compiler->rc_mode = rc_mode;
+	compiler->rc_local_count = compiler->rc_proc_base = compiler->rc_loop_base = 0;
 
 	PANIC_ON_FAIL(compiler->eval_regs = safe_malloc(safe_gc, ast->value_count * sizeof(compiler_reg_t)), compiler, ERROR_MEMORY);
 	PANIC_ON_FAIL(compiler->move_eval = safe_malloc(safe_gc, ast->value_count * sizeof(int)), compiler, ERROR_MEMORY);
 	PANIC_ON_FAIL(compiler->var_regs = safe_malloc(safe_gc, ast->var_decl_count * sizeof(compiler_reg_t)), compiler, ERROR_MEMORY);
+	memset(compiler->var_regs, 0xFF, ast->var_decl_count * sizeof(compiler_reg_t)); //variables that aren't allocated yet are never mistaken for procs
 	PANIC_ON_FAIL(compiler->proc_call_offsets = safe_malloc(safe_gc, ast->proc_call_count * sizeof(uint16_t)), compiler, ERROR_MEMORY);
 	PANIC_ON_FAIL(compiler->proc_call_max_locals = safe_calloc(safe_gc, ast->proc_count, sizeof(uint16_t)), compiler, ERROR_MEMORY);
-	PANIC_ON_FAIL(init_machine(target_machine, UINT16_MAX / 8, 1000, ast->record_count), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->procs = safe_calloc(safe_gc, ast->proc_count, sizeof(ast_proc_t*)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->proc_nests_procs = safe_calloc(safe_gc, ast->proc_count, sizeof(int)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->proc_inlinable = safe_calloc(safe_gc, ast->proc_count, sizeof(int)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->inline_callees = safe_calloc(safe_gc, ast->proc_call_count, sizeof(ast_proc_t*)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->hoisted_values = safe_calloc(safe_gc, ast->value_count, sizeof(uint8_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->var_last_uses = safe_malloc(safe_gc, ast->var_decl_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->var_alias_roots = safe_malloc(safe_gc, ast->var_decl_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+	memset(compiler->var_alias_roots, 0xFF, ast->var_decl_count * sizeof(uint32_t));
+	PANIC_ON_FAIL(compiler->loop_hoists = safe_malloc(safe_gc, (compiler->alloced_loop_hoists = 16) * sizeof(compiler_loop_hoist_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->rc_locals = safe_malloc(safe_gc, (compiler->alloced_rc_locals = 16) * sizeof(compiler_reg_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(init_machine(target_machine, ast->constant_count, ast->record_count), compiler, ERROR_MEMORY);
 
 	//define standard type signatures (array<prim>)
 	for (typecheck_base_type_t prim = TYPE_PRIMITIVE_BOOL; prim <= TYPE_PRIMITIVE_FLOAT; prim++) {
@@ -703,6 +1943,30 @@ int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine,
 
 	allocate_code_block_regs(compiler, ast->exec_block, 0, NULL);
 
+	//clones are found before any code is compiled, so that calls can go straight to them
+	if (compiler->alloced_mono_clones) {
+		PANIC_ON_FAIL(compiler->mono_clones = safe_malloc(safe_gc, compiler->alloced_mono_clones * sizeof(compiler_mono_clone_t)), compiler, ERROR_MEMORY);
+		ESCAPE_ON_FAIL(find_mono_clones(compiler, ast->exec_block));
+		for (uint_fast16_t i = 0; i < compiler->mono_clone_count; i++) {
+			compiler->current_clone = &compiler->mono_clones[i];
+			ESCAPE_ON_FAIL(find_mono_clones(compiler, compiler->procs[compiler->current_clone->proc_id]->exec_block));
+		}
+		compiler->current_clone = NULL;
+		compiler->proc_count += compiler->mono_clone_count;
+
+		//a clone uses as many locals as its generic proc
+		PANIC_ON_FAIL(compiler->proc_call_max_locals = safe_realloc(safe_gc, compiler->proc_call_max_locals, compiler->proc_count * sizeof(uint16_t)), compiler, ERROR_MEMORY);
+		for (uint_fast16_t i = 0; i < compiler->mono_clone_count; i++)
+			compiler->proc_call_max_locals[compiler->mono_clones[i].id] = compiler->proc_call_max_locals[compiler->mono_clones[i].proc_id];
+	}
+
+	PANIC_ON_FAIL(compiler->proc_body_ips = safe_malloc(safe_gc, compiler->proc_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->proc_self_tail_calls = safe_calloc(safe_gc, compiler->proc_count, sizeof(int)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->proc_label_ips = safe_malloc(safe_gc, compiler->proc_count * sizeof(uint32_t)), compiler, ERROR_MEMORY);
+	PANIC_ON_FAIL(compiler->proc_local_kinds = safe_calloc(safe_gc, compiler->proc_count, sizeof(uint8_t*)), compiler, ERROR_MEMORY);
+	for (uint_fast16_t i = 0; i < compiler->proc_count; i++)
+		compiler->proc_label_ips[i] = UINT32_MAX; //procs that don't affect state are never compiled
+
 	PANIC_ON_FAIL(init_ins_builder(&compiler->ins_builder, safe_gc), compiler, ERROR_MEMORY);
 
 	EMIT_INS(INS1(COMPILER_OP_CODE_STACK_OFFSET, GLOB_REG(compiler->ast->constant_count + compiler->current_global)));
@@ -715,7 +1979,18 @@ int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine,
 	safe_free(safe_gc, compiler->move_eval);
 	safe_free(safe_gc, compiler->var_regs);
 	safe_free(safe_gc, compiler->proc_call_offsets);
-	safe_free(safe_gc, compiler->proc_call_max_locals);
+	safe_free(safe_gc, compiler->proc_self_tail_calls);
+	safe_free(safe_gc, compiler->procs);
+	safe_free(safe_gc, compiler->proc_nests_procs);
+	safe_free(safe_gc, compiler->proc_inlinable);
+	safe_free(safe_gc, compiler->inline_callees);
+	safe_free(safe_gc, compiler->hoisted_values);
+	safe_free(safe_gc, compiler->loop_hoists);
+	safe_free(safe_gc, compiler->rc_locals);
+	safe_free(safe_gc, compiler->var_last_uses);
+	safe_free(safe_gc, compiler->var_alias_roots);
+	if (compiler->mono_clones)
+		safe_free(safe_gc, compiler->mono_clones);
 
 	return 1;
 }
@@ -759,6 +2034,16 @@ static machine_type_sig_t* compiler_define_typesig(compiler_t* compiler, ast_pro
 	safe_gc_t temp_safe_gc;
 	ESCAPE_ON_FAIL(init_safe_gc(&temp_safe_gc));
 
+	//a clone's type arguments are known at compile time
+	if (proc && compiler->current_clone) {
+		typecheck_type_t substituted;
+		if (!copy_typecheck_type(&temp_safe_gc, &substituted, type) || !typeargs_substitute(&temp_safe_gc, compiler->current_clone->typeargs, &substituted)) {
+			free_safe_gc(&temp_safe_gc, 1);
+			return NULL;
+		}
+		type = substituted;
+	}
+
 	machine_type_sig_t sig;
 	if (!compile_type_to_machine(&sig, type, compiler, &temp_safe_gc, proc)) {
 		free_safe_gc(&temp_safe_gc, 1);
@@ -8,7 +8,7 @@
 #include "machine.h"
 
 typedef struct compiler_reg {
-	uint16_t reg;
+	uint32_t reg;
 	int offset;
 } compiler_reg_t;
 
@@ -22,11 +22,26 @@ typedef enum compiler_op_code {
 
 	COMPILER_OP_CODE_JUMP,
 	COMPILER_OP_CODE_JUMP_CHECK,
+	COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL, //comparison fused with the jump check reading it, which jumps to the third operand unless the comparison holds
+	COMPILER_OP_CODE_JUMP_CHECK_BOOL_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_CHAR_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_LONG_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_FLOAT_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE,
+	COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS,
+	COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE,
+	COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS,
+	COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE_EQUAL,
+	COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS_EQUAL,
 
 	COMPILER_OP_CODE_CALL,
+	COMPILER_OP_CODE_TAIL_CALL,
 	COMPILER_OP_CODE_RETURN,
 	COMPILER_OP_CODE_STACK_VALIDATE,
 	COMPILER_OP_CODE_LABEL,
+	COMPILER_OP_CODE_NOP, //left in place of a removed instruction, since instructions are addressed by index
 
 	COMPILER_OP_CODE_LOAD_ALLOC,
 	COMPILER_OP_CODE_LOAD_ALLOC_I,
@@ -34,6 +49,11 @@ typedef enum compiler_op_code {
 	COMPILER_OP_CODE_STORE_ALLOC,
 	COMPILER_OP_CODE_STORE_ALLOC_I,
 	COMPILER_OP_CODE_STORE_ALLOC_I_BOUND,
+	COMPILER_OP_CODE_LOAD_ALLOC_INBOUND, //index is known to be within the array
+	COMPILER_OP_CODE_STORE_ALLOC_INBOUND,
+	COMPILER_OP_CODE_LOAD_ALLOC_INIT, //array is known to be fully initialized
+	COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT,
+	COMPILER_OP_CODE_LOAD_ALLOC_I_INIT, //register is known to be initialized and within the allocation
 	COMPILER_OP_CODE_CONF_TRACE,
 	COMPILER_OP_CODE_DYNAMIC_CONF,
 	COMPILER_OP_CODE_DYNAMIC_CONF_ALL,
@@ -43,9 +63,11 @@ typedef enum compiler_op_code {
 
 	COMPILER_OP_CODE_ALLOC,
 	COMPILER_OP_CODE_ALLOC_I,
+	COMPILER_OP_CODE_ALLOC_I_INIT, //every register is initialized before it's read and nothing traces it, so no init status is kept
 
 	COMPILER_OP_CODE_FREE,
 	COMPILER_OP_CODE_DYNAMIC_FREE,
+	COMPILER_OP_CODE_RC_RELEASE, //buffers what a local referenced as a reference counting candidate, once it's overwritten or goes out of scope
 
 	COMPILER_OP_CODE_GC_NEW_FRAME,
 	COMPILER_OP_CODE_GC_TRACE,
@@ -93,6 +115,7 @@ typedef enum compiler_op_code {
 	COMPILER_OP_CODE_LONG_DECREMENT,
 	COMPILER_OP_CODE_FLOAT_INCREMENT,
 	COMPILER_OP_CODE_FLOAT_DECREMENT,
+	COMPILER_OP_CODE_LONG_DIVIDE_NONZERO, //divisor is known to be nonzero
 
 	COMPILER_OP_CODE_CONFIG_TYPESIG,
 	COMPILER_OP_CODE_RUNTIME_TYPECHECK,
@@ -114,18 +137,71 @@ typedef enum compiler_op_code {
 	COMPILER_OP_CODE_SET_EXTRA_ARGS
 } compiler_op_code_t;
 
+//what a proc's local register holds, which decides whether it can be lowered to a c local
+#define LOCAL_KIND_PRIMITIVE 1
+#define LOCAL_KIND_UNLOWERABLE 2
+
 typedef struct compiler_ins {
 	compiler_op_code_t op_code;
 	compiler_reg_t regs[3];
 } compiler_ins_t;
 
+//how an instruction uses each of its operands
+#define OPERAND_IMMEDIATE 0
+#define OPERAND_READ 1
+#define OPERAND_WRITE 2
+#define OPERAND_READ_WRITE (OPERAND_READ | OPERAND_WRITE)
+
 typedef struct ins_builder {
 	compiler_ins_t* instructions;
-	uint16_t instruction_count, alloced_ins;
+	uint32_t instruction_count, alloced_ins;
 
 	safe_gc_t* safe_gc;
 } ins_builder_t;
 
+//a generic proc compiled for one tuple of concrete type arguments
+typedef struct compiler_mono_clone {
+	uint16_t proc_id; //the generic proc it's cloned from
+	uint16_t id;
+	compiler_reg_t proc_reg;
+
+	typecheck_type_t* typeargs;
+
+	uint32_t* src_locs; //the clone's copies of its generic proc's debug source locations
+} compiler_mono_clone_t;
+
+#define MAX_LOOP_CLOBBERED_PROPS 32
+
+//what may be written on any iteration of a loop, including by the procs it calls
+typedef struct compiler_loop_effects {
+	uint8_t* var_writes;
+	uint16_t clobbered_props[MAX_LOOP_CLOBBERED_PROPS]; //the slots of record properties that are set
+	uint8_t clobbered_prop_count;
+	int clobbers_all; //calls something that can't be followed, so anything may be written besides the caller's locals
+
+	uint8_t* visited_procs;
+} compiler_loop_effects_t;
+
+#define LOOP_VAR_STEPPED 1 //only incremented or decremented
+#define LOOP_VAR_ASSIGNED 2
+
+//a variable's register, which later variables of its block may reuse once the last statement using it has run
+typedef struct compiler_block_slot {
+	uint16_t reg;
+	uint32_t last_use;
+} compiler_block_slot_t;
+
+//a value evaluated once before a loop is entered, rather than on every iteration
+typedef struct compiler_loop_hoist {
+	ast_cond_t* loop;
+	ast_value_t value;
+
+	//a product of an induction variable and an invariant step is kept up to date by adding the step whenever the variable is stepped
+	ast_var_info_t* induction_var;
+	ast_value_t* step;
+	int active;
+} compiler_loop_hoist_t;
+
 typedef struct compiler {
 	compiler_reg_t* eval_regs;
 	int* move_eval;
@@ -134,6 +210,44 @@ typedef struct compiler {
 
 	uint16_t* proc_call_offsets;
 	uint16_t* proc_call_max_locals;
+	uint32_t* proc_body_ips;
+	uint32_t* proc_label_ips; //UINT32_MAX for procs that are never compiled
+	int* proc_self_tail_calls;
+
+	uint8_t** proc_local_kinds;
+
+	ast_proc_t** procs;
+	int* proc_nests_procs;
+	uint16_t proc_count; //compiled procs, including monomorphized clones
+
+	compiler_mono_clone_t* mono_clones;
+	compiler_mono_clone_t* current_clone;
+	uint16_t mono_clone_count, alloced_mono_clones, mono_limit;
+
+	ast_proc_t** inline_callees; //the proc each call's body may be spliced in from, generic ones only once they're cloned for its type arguments
+	int* proc_inlinable;
+	uint16_t inline_limit; //the most values and statements a proc may have to be inlined
+
+	//the call being inlined, whose callee's frame is laid over the call's stack area in the frame of inline_frame
+	uint8_t inline_depth;
+	uint16_t inline_offset, inline_frame;
+	uint32_t inline_returns;
+	uint32_t* inline_src_locs;
+
+	compiler_loop_hoist_t* loop_hoists;
+	uint8_t* hoisted_values; //values evaluated before the loop they're in, and skipped where they're used
+	uint16_t loop_hoist_count, alloced_loop_hoists;
+	int optimize_loops;
+
+	uint32_t* var_last_uses; //the statement of the block being allocated that last uses each variable
+	uint32_t* var_alias_roots; //the variable whose register each variable shares, if any
+	int compact_frames;
+
+	//the reference typed locals in scope, which reference counting releases as they go out of scope
+	compiler_reg_t* rc_locals;
+	uint16_t rc_local_count, alloced_rc_locals;
+	uint16_t rc_proc_base, rc_loop_base; //the first of them declared by the proc, or inlined body, and the loop being compiled
+	int rc_mode;
 
 	ast_t* ast;
 	machine_t* target_machine;
@@ -149,5 +263,10 @@ typedef struct compiler {
 int init_ins_builder(ins_builder_t* ins_builder, safe_gc_t* safe_gc);
 int ins_builder_append_ins(ins_builder_t* ins_builder, compiler_ins_t ins);
 
-int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine, ast_t* ast);
+int compile(compiler_t* compiler, safe_gc_t* safe_gc, machine_t* target_machine, ast_t* ast, uint16_t mono_limit, uint16_t inline_limit, int optimize_loops, int compact_frames, int rc_mode);
+
+uint32_t next_proc_ip(compiler_ins_t* instructions, uint32_t ip);
+uint16_t find_callee(compiler_t* compiler, compiler_reg_t proc_reg);
+void ins_operand_roles(compiler_ins_t ins, uint8_t* roles);
+uint32_t max_frame_span(compiler_t* compiler);
 #endif // !COMPILER_H
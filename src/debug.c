@@ -83,6 +83,17 @@ int debug_table_add_loc(dbg_table_t* dbg_table, multi_scanner_t multi_scanner, u
 	return 1;
 }
 
+int debug_table_copy_loc(dbg_table_t* dbg_table, uint32_t src_loc_id, uint32_t* output_src_loc_id) {
+	if (dbg_table->src_loc_count == dbg_table->alloced_src_locs)
+		ESCAPE_ON_FAIL(dbg_table->src_locations = safe_realloc(dbg_table->safe_gc, dbg_table->src_locations, (dbg_table->alloced_src_locs += 16) * sizeof(dbg_src_loc_t)));
+	dbg_src_loc_t* src_loc = &dbg_table->src_locations[*output_src_loc_id = dbg_table->src_loc_count++];
+
+	*src_loc = dbg_table->src_locations[src_loc_id];
+	src_loc->min_ip = UINT64_MAX;
+	src_loc->max_ip = 0;
+	return 1;
+}
+
 void debug_loc_set_minip(dbg_table_t* dbg_table, uint32_t src_loc_id, uint64_t min_ip) {
 	if (min_ip < dbg_table->src_locations[src_loc_id].min_ip)
 		dbg_table->src_locations[src_loc_id].min_ip = min_ip;
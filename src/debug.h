@@ -31,6 +31,7 @@ int init_debug_table(dbg_table_t* dbg_table, safe_gc_t* safe_gc);
 void free_debug_table(dbg_table_t* dbg_table);
 
 int debug_table_add_loc(dbg_table_t* dbg_table, multi_scanner_t multi_scanner, uint32_t* output_src_loc_id);
+int debug_table_copy_loc(dbg_table_t* dbg_table, uint32_t src_loc_id, uint32_t* output_src_loc_id);
 void debug_loc_set_minip(dbg_table_t* dbg_table, uint32_t src_loc_id, uint64_t min_ip);
 void debug_loc_set_maxip(dbg_table_t* dbg_table, uint32_t src_loc_id, uint64_t max_ip);
 
@@ -8,10 +8,70 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 
-int emit_c_header(FILE* fileout, int robo_mode, int dbg) {
-	if (dbg)
-		fputs("#define CISH_DEBUG", fileout);
-	if (robo_mode)
+#define RUNTIME_TABLE_NAME(TABLE, NAME) #NAME,
+static const char* runtime_table_names[RUNTIME_TABLE_COUNT] = { RUNTIME_TABLES(RUNTIME_TABLE_NAME) };
+#undef RUNTIME_TABLE_NAME
+
+//reads the table high-water marks recorded by a capacity profiled program
+int read_capacity_profile(uint32_t* capacities, const char* path) {
+	FILE* profile = fopen(path, "r");
+	ESCAPE_ON_FAIL(profile);
+
+	for (uint_fast8_t i = 0; i < RUNTIME_TABLE_COUNT; i++)
+		capacities[i] = 0;
+
+	char table_name[64];
+	uint32_t high_water;
+	while (fscanf(profile, "%63s %"SCNu32, table_name, &high_water) == 2)
+		for (uint_fast8_t i = 0; i < RUNTIME_TABLE_COUNT; i++)
+			if (!strcmp(table_name, runtime_table_names[i]))
+				capacities[i] = high_water < 16 ? 16 : high_water;
+	fclose(profile);
+
+	for (uint_fast8_t i = 0; i < RUNTIME_TABLE_COUNT; i++)
+		if (!capacities[i])
+			return 0;
+	return 1;
+}
+
+int emit_c_header(FILE* fileout, runtime_options_t* options) {
+	fputs("#define RUNTIME_TABLES(X)", fileout);
+#define EMIT_RUNTIME_TABLE(TABLE, NAME) fputs(" X(" #TABLE ", " #NAME ")", fileout);
+	RUNTIME_TABLES(EMIT_RUNTIME_TABLE)
+#undef EMIT_RUNTIME_TABLE
+	fputc('\n', fileout);
+	if (options->capacity_profile) {
+		fputs("#define CAPACITY_PROFILE \"", fileout);
+		for (const char* path_it = options->capacity_profile; *path_it; ++path_it) {
+			if (*path_it == '\\' || *path_it == '"')
+				fputc('\\', fileout);
+			fputc(*path_it, fileout);
+		}
+		fputs("\"\n", fileout);
+	}
+	if (options->stack_size)
+		fprintf(fileout, "#define STACK_SIZE %"PRIu32"\n", options->stack_size);
+	if (options->frame_limit)
+		fprintf(fileout, "#define FRAME_LIMIT %"PRIu16"\n", options->frame_limit);
+	if (options->growable_stack)
+		fputs("#define GROWABLE_STACK\n", fileout);
+	if (options->rc_mode) {
+		fprintf(fileout, "#define RC_MODE\n#define RC_FRAME_SPAN %"PRIu32"\n", options->rc_frame_span);
+		if (options->rc_threshold)
+			fprintf(fileout, "#define RC_COLLECT_THRESHOLD %"PRIu32"\n", options->rc_threshold);
+	}
+	if (options->gc_step_budget) {
+		fprintf(fileout, "#define INCREMENTAL_GC\n#define GC_STEP_BUDGET %"PRIu32"\n", options->gc_step_budget);
+		if (options->gc_step_micros)
+			fputs("#define GC_STEP_MICROS\n", fileout);
+	}
+	if (options->stats)
+		fputs("#define RUNTIME_STATS\n", fileout);
+	if (options->heap_profile)
+		fputs("#define HEAP_PROFILE\n", fileout);
+	if (options->debug)
+		fputs("#define CISH_DEBUG\n", fileout);
+	if (options->robo_mode)
 		fputs("#define ROBOMODE\n\n", fileout);
 
 	char* header_data = file_read_source("stdheader.c");
@@ -54,7 +114,8 @@ int emit_debug_info(FILE* file_out, dbg_table_t* dbg_table, label_buf_t* label_b
 void emit_constants(FILE* file_out, ast_t* ast, machine_t* machine) {
 	fputs("//initializes all hardcode constants\nstatic void init_constants() {", file_out);
 	for (uint16_t i = 0; i < ast->constant_count; i++)
-		fprintf(file_out, "\n\tstack[%"PRIu16"].long_int = %"PRIi64";", i, machine->stack[i].long_int);
+		if (machine->stack[i].long_int) //the runtime stack starts zeroed, and constants only referenced by dead code are never set
+			fprintf(file_out, "\n\tstack[%"PRIu16"].long_int = %"PRIi64";", i, machine->stack[i].long_int);
 	fputs("\n}\n", file_out);
 }
 
@@ -89,13 +150,18 @@ static int emit_type_info(FILE* file_out, ast_t* ast, machine_t* machine) {
 	return 1;
 }
 
-int emit_init(FILE* file_out, ast_t* ast, machine_t* machine, int dbg) {
+int emit_init(FILE* file_out, ast_t* ast, machine_t* machine, int dbg, int heap_profile, uint32_t* capacities) {
 	fputs("\n//initializes everything\nstatic int init_all() {\n", file_out);
+	if (capacities)
+		for (uint_fast8_t i = 0; i < RUNTIME_TABLE_COUNT; i++)
+			fprintf(file_out, "\truntime_capacities[%"PRIuFAST8"] = %"PRIu32"; //%s\n", i, capacities[i], runtime_table_names[i]);
 	fprintf(file_out, "\tESCAPE_ON_FAIL(init_runtime(%i));\n\tinit_constants();\n", ast->record_count);
 	ESCAPE_ON_FAIL(emit_type_info(file_out, ast, machine));
 
 	if (dbg)
 		fputs("\tESCAPE_ON_FAIL(init_dbg_syms());\n", file_out);
+	if (heap_profile)
+		fputs("\tESCAPE_ON_FAIL(init_heap_profile());\n", file_out);
 
 	fputs("\treturn 1;\n}\n", file_out);
 	return 1;
@@ -104,589 +170,822 @@ int emit_init(FILE* file_out, ast_t* ast, machine_t* machine, int dbg) {
 static void emit_reg(FILE* file_out, compiler_reg_t reg, int get_ptr) {
 	if (get_ptr)
 		fputc('&', file_out);
-	fprintf(file_out, "stack[%"PRIu16, reg.reg);
-	if (reg.offset)
-		fputs(" + global_offset", file_out);
-	fputc(']', file_out);
+	if (reg.offset == C_LOCAL_OFFSET)
+		fprintf(file_out, "loc%"PRIu32"_%"PRIu32, reg.reg >> 16, reg.reg & UINT16_MAX);
+	else if (reg.offset)
+		fprintf(file_out, "fp[%"PRIu32"]", reg.reg); //locals are addressed through run's frame pointer, which gcc can keep in a register
+	else
+		fprintf(file_out, "stack[%"PRIu32"]", reg.reg);
 }
 
-int emit_instructions(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t count, int dbg, dbg_table_t* dbg_table) {
-	uint16_t extra_a, extra_b, extra_c;
-	static const char* num_types[] = {
-		"long_int",
-		"float_int"
-	};
-	//machine_type_sig_t* sig; void* scratch_ip; heap_alloc_t* scratch_heap;
-	fputs("\n//runs the instructions\nstatic int run() {\n\tvoid* scratch_ptr; int64_t scratch_i; machine_type_sig_t scratch_sig, aux_sig2; \n", file_out);
-
-	for (uint_fast64_t i = 0; i < count; i++) {
-		dbg_src_loc_t* src_loc = dbg_table_find_src_loc(dbg_table, i);
-		ESCAPE_ON_FAIL(src_loc);
-		uint64_t src_loc_id = src_loc - dbg_table->src_locations;
-
-		if (label_buf->ins_label[i]) {
-			fprintf(file_out, "label%"PRIu16":", label_buf->ins_label[i]);
-			fputc('\n', file_out);
+//saves a proc's c locals below a call's offset to their stack registers, or restores them from the callee's frame once it returns
+static void emit_spill_locals(FILE* file_out, local_lowering_t* lowering, uint16_t proc, uint32_t call_offset, int reload) {
+	for (uint_fast32_t i = 1; i < call_offset && i <= lowering->local_counts[proc]; i++)
+		if (lowering->lowered[proc][i]) {
+			if (reload)
+				fprintf(file_out, "loc%"PRIu16"_%"PRIuFAST32" = fp[%"PRIuFAST32" - %"PRIu32"];", proc, i, i, call_offset);
+			else
+				fprintf(file_out, "fp[%"PRIuFAST32"] = loc%"PRIu16"_%"PRIuFAST32";", i, proc, i);
 		}
-		fputc('\t', file_out);
+}
 
-		switch (instructions[i].op_code) {
-		case COMPILER_OP_CODE_SET_EXTRA_ARGS:
-			extra_a = instructions[i].regs[0].reg;
-			extra_b = instructions[i].regs[1].reg;
-			extra_c = instructions[i].regs[2].reg;
-			break;
-		case COMPILER_OP_CODE_ABORT:
-			if (instructions[i].regs[0].reg == ERROR_NONE)
-				fputs("return 1;", file_out);
-			else
-				fprintf(file_out, "PANIC(%"PRIu16", %"PRIu64");", instructions[i].regs[0].reg, src_loc_id);
-			break;
-		case COMPILER_OP_CODE_FOREIGN:
-			fputs("if(!ffi_invoke(&ffi_table, ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 1);
-			fputc(',', file_out);
-			emit_reg(file_out, instructions[i].regs[1], 1);
-			fputc(',', file_out);
-			emit_reg(file_out, instructions[i].regs[2], 1);
-			if(dbg)
-				fprintf(file_out, ")) { last_err = last_err == CISH_ERROR_NONE ? CISH_ERROR_FOREIGN : last_err; last_src_loc = %"PRIu64"; return 0;}", src_loc_id);
-			else
-				fputs(")) { last_err = last_err == CISH_ERROR_NONE ? CISH_ERROR_FOREIGN : last_err; return 0;}", file_out);
-			break;
-		case COMPILER_OP_CODE_MOVE:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(" = ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputc(';', file_out);
-			break;
-		case COMPILER_OP_CODE_SET:
-			if (instructions[i].regs[2].reg) { //atomotize signature
-				fprintf(file_out, "PANIC_ON_FAIL(defined_sig_count != SIG_COUNT_MAX, CISH_ERROR_STACK_OVERFLOW, %"PRIu64");", src_loc_id);
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fprintf(file_out, ".long_int = defined_sig_count; scratch_ptr=&defined_signatures[defined_sig_count++]; PANIC_ON_FAIL((machine_type_sig_t*)scratch_ptr, CISH_ERROR_MEMORY, %"PRIu64"); "
-					"PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu16"], scratch_ptr, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id, instructions[i].regs[1].reg, src_loc_id);
-			}
-			else {//do not atomotize signature
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fprintf(file_out, ".long_int = %"PRIu16";", instructions[i].regs[1].reg);
-			}
-			break;
-		case COMPILER_OP_CODE_POP_ATOM_TYPESIGS:
-			fprintf(file_out, "if(%"PRIu16" > defined_sig_count) { PANIC(CISH_ERROR_STACK_OVERFLOW, %"PRIu64"); }; \n", instructions[i].regs[0].reg, src_loc_id);
-			for (uint16_t i = 0; i < instructions[i].regs[0].reg; i++) {
-				fprintf(file_out, "\tfree_type_signature(&defined_signatures[defined_sig_count - %"PRIu16"]);\n", i + 1);
-			}
-			fprintf(file_out, "\tdefined_sig_count -= %"PRIu16";", instructions[i].regs[0].reg);
-			break;
-		case COMPILER_OP_CODE_JUMP:
-			fprintf(file_out, "goto label%"PRIu16";", label_buf->ins_label[instructions[i].regs[0].reg]);
-			break;
-		case COMPILER_OP_CODE_JUMP_CHECK:
-			fputs("if(!", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".bool_flag) { goto label%"PRIu16";}", label_buf->ins_label[instructions[i].regs[1].reg]);
-			break;
-		case COMPILER_OP_CODE_CALL:
-			fprintf(file_out, "PANIC_ON_FAIL(position_count != FRAME_LIMIT, CISH_ERROR_STACK_OVERFLOW, %"PRIu64");", src_loc_id);
+//emits the c function a call goes to, which is cast from the callee's register when the call goes through a first-class proc value
+static void emit_proc_function(FILE* file_out, compiler_t* compiler, compiler_reg_t proc_reg) {
+	uint16_t callee = find_callee(compiler, proc_reg);
+	if (callee != UINT16_MAX)
+		fprintf(file_out, "proc%"PRIu16, callee);
+	else if (proc_reg.offset)
+		fputs("((int(*)(machine_reg_t*))scratch_ptr)", file_out);
+	else {
+		fputs("((int(*)(machine_reg_t*))", file_out);
+		emit_reg(file_out, proc_reg, 0);
+		fputs(".ip)", file_out);
+	}
+}
+
+//declares a proc's lowered registers as c locals
+static void emit_local_decls(FILE* file_out, local_lowering_t* lowering, uint16_t proc) {
+	if (lowering->lowered[proc])
+		for (uint_fast32_t i = 1; i <= lowering->local_counts[proc]; i++)
+			if (lowering->lowered[proc][i])
+				fprintf(file_out, "machine_reg_t loc%"PRIu16"_%"PRIuFAST32" = { 0 }; ", proc, i);
+}
+
+static uint32_t extra_a, extra_b, extra_c;
+static const char* num_types[] = {
+	"long_int",
+	"float_int"
+};
+
+//emits a single instruction; compiler is only given when procs are emitted as their own c functions, and emitting_proc is the proc being emitted, or UINT16_MAX for run
+static int emit_instruction(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t i, int dbg, dbg_table_t* dbg_table, local_lowering_t* lowering, compiler_t* compiler, uint16_t emitting_proc) {
+	dbg_src_loc_t* src_loc = dbg_table_find_src_loc(dbg_table, i);
+	ESCAPE_ON_FAIL(src_loc);
+	uint64_t src_loc_id = src_loc - dbg_table->src_locations;
 
-			if (dbg)
-				fprintf(file_out, "src_loc_stack[position_count] = %"PRIu64";", src_loc_id);
-			fprintf(file_out, "positions[position_count++] = &&label%"PRIu16";", label_buf->ins_label[i + 1]);
-			
+	if (label_buf->ins_label[i]) {
+		fprintf(file_out, "label%"PRIu32":", label_buf->ins_label[i]);
+		fputc('\n', file_out);
+	}
+	fputc('\t', file_out);
+
+	switch (instructions[i].op_code) {
+	case COMPILER_OP_CODE_SET_EXTRA_ARGS:
+		extra_a = instructions[i].regs[0].reg;
+		extra_b = instructions[i].regs[1].reg;
+		extra_c = instructions[i].regs[2].reg;
+		break;
+	case COMPILER_OP_CODE_ABORT:
+		if (instructions[i].regs[0].reg == ERROR_NONE && emitting_proc != UINT16_MAX)
+			fputs("last_err = CISH_ERROR_NONE; return 0;", file_out); //unwinds every proc function up to run, which then finishes normally
+		else if (instructions[i].regs[0].reg == ERROR_NONE)
+			fputs("return 1;", file_out);
+		else
+			fprintf(file_out, "PANIC(%"PRIu32", %"PRIu64");", instructions[i].regs[0].reg, src_loc_id);
+		break;
+	case COMPILER_OP_CODE_FOREIGN:
+		fprintf(file_out, "HEAP_PROFILE_LOC(%"PRIu64");", src_loc_id);
+		fputs("if(!ffi_invoke(&ffi_table, ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 1);
+		fputc(',', file_out);
+		emit_reg(file_out, instructions[i].regs[1], 1);
+		fputc(',', file_out);
+		emit_reg(file_out, instructions[i].regs[2], 1);
+		if(dbg)
+			fprintf(file_out, ")) { last_err = last_err == CISH_ERROR_NONE ? CISH_ERROR_FOREIGN : last_err; last_src_loc = %"PRIu64"; return 0;}", src_loc_id);
+		else
+			fputs(")) { last_err = last_err == CISH_ERROR_NONE ? CISH_ERROR_FOREIGN : last_err; return 0;}", file_out);
+		break;
+	case COMPILER_OP_CODE_MOVE:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(" = ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputc(';', file_out);
+		break;
+	case COMPILER_OP_CODE_SET:
+		if (instructions[i].regs[2].reg) { //atomotize signature
+			fprintf(file_out, "PANIC_ON_FAIL(defined_sig_count != SIG_COUNT_MAX, CISH_ERROR_STACK_OVERFLOW, %"PRIu64");", src_loc_id);
+			emit_reg(file_out, instructions[i].regs[0], 0);
+			fprintf(file_out, ".long_int = defined_sig_count; scratch_ptr=&defined_signatures[defined_sig_count++]; PANIC_ON_FAIL((machine_type_sig_t*)scratch_ptr, CISH_ERROR_MEMORY, %"PRIu64"); "
+				"PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu32"], scratch_ptr, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id, instructions[i].regs[1].reg, src_loc_id);
+		}
+		else {//do not atomotize signature
+			emit_reg(file_out, instructions[i].regs[0], 0);
+			fprintf(file_out, ".long_int = %"PRIu32";", instructions[i].regs[1].reg);
+		}
+		break;
+	case COMPILER_OP_CODE_POP_ATOM_TYPESIGS:
+		fprintf(file_out, "if(%"PRIu32" > defined_sig_count) { PANIC(CISH_ERROR_STACK_OVERFLOW, %"PRIu64"); }; \n", instructions[i].regs[0].reg, src_loc_id);
+		for (uint16_t i = 0; i < instructions[i].regs[0].reg; i++) {
+			fprintf(file_out, "\tfree_type_signature(&defined_signatures[defined_sig_count - %"PRIu16"]);\n", i + 1);
+		}
+		fprintf(file_out, "\tdefined_sig_count -= %"PRIu32";", instructions[i].regs[0].reg);
+		break;
+	case COMPILER_OP_CODE_JUMP:
+		if (instructions[i].regs[0].reg <= i)
+			fputs("GC_SAFEPOINT;", file_out); //loop back-edges are safepoints for incremental sweeping
+		fprintf(file_out, "goto label%"PRIu32";", label_buf->ins_label[instructions[i].regs[0].reg]);
+		break;
+	case COMPILER_OP_CODE_JUMP_CHECK:
+		fputs("if(!", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag) { ", file_out);
+		if (instructions[i].regs[1].reg <= i)
+			fputs("GC_SAFEPOINT;", file_out); //threaded jumps may branch backwards
+		fprintf(file_out, "goto label%"PRIu32";}", label_buf->ins_label[instructions[i].regs[1].reg]);
+		break;
+	case COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_BOOL_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_CHAR_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE_EQUAL:
+	case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS_EQUAL: {
+		static const char* comp_prop[] = {
+			"ip", "bool_flag", "char_int", "long_int", "float_int",
+			"long_int", "long_int", "long_int", "long_int",
+			"float_int", "float_int", "float_int", "float_int"
+		};
+		static const char* operators[] = {
+			"==", "==", "==", "==", "==",
+			">", "<", ">=", "<=",
+			">", "<", ">=", "<="
+		};
+		int op_id = instructions[i].op_code - COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL;
+
+		//negated as a whole, so comparisons with nan jump just like the unfused jump check would
+		fputs("if(!(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".%s %s ", comp_prop[op_id], operators[op_id]);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".%s)) { ", comp_prop[op_id]);
+		if (instructions[i].regs[2].reg <= i)
+			fputs("GC_SAFEPOINT;", file_out);
+		fprintf(file_out, "goto label%"PRIu32";}", label_buf->ins_label[instructions[i].regs[2].reg]);
+		break;
+	}
+	case COMPILER_OP_CODE_NOP:
+		fputc(';', file_out);
+		break;
+	case COMPILER_OP_CODE_CALL:
+		fprintf(file_out, "GC_SAFEPOINT; FRAME_CHECK(position_count, %"PRIu64");", src_loc_id);
+
+		if (dbg)
+			fprintf(file_out, "src_loc_stack[position_count] = %"PRIu64";", src_loc_id);
+		if (compiler) {
+			//the c call stack keeps return addresses, and each call's own c locals, so the position stack only tracks call depth
+			fputs("position_count++;", file_out);
 			if (instructions[i].regs[0].offset) {
 				fputs("scratch_ptr = ", file_out);
 				emit_reg(file_out, instructions[i].regs[0], 0);
 				fputs(".ip;", file_out);
 			}
-			fprintf(file_out, "global_offset += %"PRIu16";", instructions[i].regs[1].reg);
-
-			if (instructions[i].regs[0].offset) {
-				fputs("goto *scratch_ptr;", file_out);
-			}
-			else {
-				fputs("goto *(", file_out);
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fputs(".ip);", file_out);
-			}
-			break;
-		case COMPILER_OP_CODE_RETURN:
-			fputs("goto *(positions[--position_count]);", file_out);
+			fprintf(file_out, "global_offset += %"PRIu32"; fp += %"PRIu32";", instructions[i].regs[1].reg, instructions[i].regs[1].reg);
+			fputs("RUNTIME_STATS_CALL_DEPTH; if(!", file_out);
+			emit_proc_function(file_out, compiler, instructions[i].regs[0]);
+			fprintf(file_out, "(fp)) { return %s; } position_count--; RELOAD_FRAME_POINTER;", emitting_proc == UINT16_MAX ? "last_err == CISH_ERROR_NONE" : "0");
 			break;
-		case COMPILER_OP_CODE_STACK_VALIDATE:
-			fprintf(file_out, "PANIC_ON_FAIL((global_offset + %"PRIu16") < STACK_LIMIT, CISH_ERROR_STACK_OVERFLOW, %"PRIu64");", instructions[i].regs[0].reg, src_loc_id);
-			break;
-		case COMPILER_OP_CODE_LABEL:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".ip = &&label%"PRIu16";", label_buf->ins_label[instructions[i].regs[1].reg]);
-			break;
-		case COMPILER_OP_CODE_LOAD_ALLOC:
-			//set scratchepads
-			fputs("scratch_ptr = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-			fputs("scratch_i = ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int;", file_out);
-
-			//bounds check
-			fprintf(file_out, "PANIC_ON_FAIL(scratch_i < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", src_loc_id);
-			//mem init check
-			fprintf(file_out, "PANIC_ON_FAIL(((heap_alloc_t*)scratch_ptr)->init_stat[scratch_i], CISH_ERROR_READ_UNINIT, %"PRIu64");", src_loc_id);
-
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(" = ((heap_alloc_t*)scratch_ptr)->registers[scratch_i];", file_out);
-			break;
-		case COMPILER_OP_CODE_LOAD_ALLOC_I:
-			//set scratchepads
-			fputs("scratch_ptr = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-
-			//mem init check
-			fprintf(file_out, "PANIC_ON_FAIL(((heap_alloc_t*)scratch_ptr)->init_stat[%"PRIu16"], CISH_ERROR_READ_UNINIT, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, " = ((heap_alloc_t*)scratch_ptr)->registers[%"PRIu16"];", instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
-			//set scratchepads
-			fputs("scratch_ptr = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-
-			//bounds check
-			fprintf(file_out, "PANIC_ON_FAIL(%"PRIu16" < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-
-			//mem init check
-			fprintf(file_out, "PANIC_ON_FAIL(((heap_alloc_t*)scratch_ptr)->init_stat[%"PRIu16"], CISH_ERROR_READ_UNINIT, %"PRIu64"); ", instructions[i].regs[2].reg, src_loc_id);
-
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, " = ((heap_alloc_t*)scratch_ptr)->registers[%"PRIu16"];", instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_STORE_ALLOC:
-			//set scratchpads
-			fputs("scratch_ptr = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-			fputs("scratch_i = ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int;", file_out);
-
-			//bounds check
-			fprintf(file_out, "PANIC_ON_FAIL(scratch_i < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", src_loc_id);
-
-			//set mem init status
-			fputs("((heap_alloc_t*)scratch_ptr)->init_stat[scratch_i] = 1;", file_out);
-			fputs("((heap_alloc_t*)scratch_ptr)->registers[scratch_i] = ", file_out);
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputc(';', file_out);
-			break;
-		case COMPILER_OP_CODE_STORE_ALLOC_I:
-			//set scratchpads
+		}
+		if (lowering && instructions[i].regs[2].offset) {
+			emit_spill_locals(file_out, lowering, instructions[i].regs[2].reg, instructions[i].regs[1].reg, 0);
+			fprintf(file_out, "positions[position_count++] = &&reload%"PRIu64";", i);
+		}
+		else
+			fprintf(file_out, "positions[position_count++] = &&label%"PRIu32";", label_buf->ins_label[i + 1]);
+		
+		if (instructions[i].regs[0].offset) {
 			fputs("scratch_ptr = ", file_out);
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-
-			//set mem init status
-			fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->init_stat[%"PRIu16"] = 1;", instructions[i].regs[2].reg);
+			fputs(".ip;", file_out);
+		}
+		fprintf(file_out, "global_offset += %"PRIu32"; fp += %"PRIu32";", instructions[i].regs[1].reg, instructions[i].regs[1].reg);
+		fputs("RUNTIME_STATS_CALL_DEPTH;", file_out);
 
-			fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->registers[%"PRIu16"] = ", instructions[i].regs[2].reg);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputc(';', file_out);
-			break;
-		case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
-			//set scratchpads
-			fputs("scratch_ptr = ", file_out);
+		if (instructions[i].regs[0].offset) {
+			fputs("goto *scratch_ptr;", file_out);
+		}
+		else {
+			fputs("goto *(", file_out);
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-
-			//bounds check
-			fprintf(file_out, "PANIC_ON_FAIL(%"PRIu16" < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-
-			//set mem init status
-			fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->init_stat[%"PRIu16"] = 1;", instructions[i].regs[2].reg);
-
-			fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->registers[%"PRIu16"] = ", instructions[i].regs[2].reg);
-			emit_reg(file_out, instructions[i].regs[1], 0);
+			fputs(".ip);", file_out);
+		}
+		if (lowering && instructions[i].regs[2].offset) {
+			fprintf(file_out, "reload%"PRIu64":", i);
+			emit_spill_locals(file_out, lowering, instructions[i].regs[2].reg, instructions[i].regs[1].reg, 1);
+		}
+		break;
+	case COMPILER_OP_CODE_TAIL_CALL:
+		//the callee returns straight to this proc's caller
+		fputs("GC_SAFEPOINT; scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".ip;", file_out);
+		for (uint_fast32_t j = 0; j < instructions[i].regs[2].reg; j++) {
+			emit_reg(file_out, (compiler_reg_t) { .reg = j + 1, .offset = 1 }, 0);
+			fputs(" = ", file_out);
+			emit_reg(file_out, (compiler_reg_t) { .reg = instructions[i].regs[1].reg + j + 1, .offset = 1 }, 0);
 			fputc(';', file_out);
-			break;
-		case COMPILER_OP_CODE_CONF_TRACE:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->trace_stat[%"PRIu16"] = %"PRIu16";", instructions[i].regs[1].reg, instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_CONF:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->trace_stat[%"PRIu16"] = (defined_signatures[", instructions[i].regs[1].reg);
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".long_int].super_signature >= 9);", file_out);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_CONF_ALL:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->trace_mode = (defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 9);", file_out);
-			break;
-		case COMPILER_OP_CODE_STACK_OFFSET:
-			fprintf(file_out, "global_offset += %"PRIu16";", instructions[i].regs[0].reg);
-			break;
-		case COMPILER_OP_CODE_STACK_DEOFFSET:
-			fprintf(file_out, "global_offset -= %"PRIu16";", instructions[i].regs[0].reg);
-			break;
-		case COMPILER_OP_CODE_ALLOC:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc = alloc(", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".long_int, %"PRIu16");", instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_ALLOC_I:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc = alloc(%"PRIu16", %"PRIu16");", instructions[i].regs[1].reg, instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_FREE:
-			fputs("if(defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 9) { ", file_out);
-		case COMPILER_OP_CODE_FREE:
-			fputs("PANIC_ON_FAIL(free_alloc(", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			if (instructions[i].op_code == COMPILER_OP_CODE_DYNAMIC_FREE)
-				fputc('}', file_out);
-			break;
-		case COMPILER_OP_CODE_GC_NEW_FRAME:
-			fprintf(file_out, "PANIC_ON_FAIL(heap_frame != FRAME_LIMIT, CISH_ERROR_STACK_OVERFLOW, %"PRIu64");"
-				"heap_frame_bounds[heap_frame] = heap_count;"
-				"trace_frame_bounds[heap_frame] = trace_count;"
-				"heap_frame++;", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_GC_TRACE:
-			fputs("TRACE_COUNT_CHECK; (heap_traces[trace_count++] = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc)->gc_flag = %"PRIu16";", instructions[i].regs[1].reg);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TRACE:
-			fputs("TRACE_COUNT_CHECK; (heap_traces[trace_count++] = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc)->gc_flag = (defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 9);", file_out);
-			break;
-		case COMPILER_OP_CODE_GC_CLEAN:
-			fprintf(file_out, "PANIC_ON_FAIL(gc_clean(), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_AND:
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".bool_flag = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag && ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".bool_flag;", file_out);
-			break;
-		case COMPILER_OP_CODE_OR:
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".bool_flag = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag || ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".bool_flag;", file_out);
-			break;
-		case COMPILER_OP_CODE_NOT:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag = !", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".bool_flag;", file_out);
-			break;
-		case COMPILER_OP_CODE_LENGTH:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".long_int = ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".heap_alloc->limit;", file_out);
-			break;
-		case COMPILER_OP_CODE_PTR_EQUAL:
-		case COMPILER_OP_CODE_BOOL_EQUAL:
-		case COMPILER_OP_CODE_CHAR_EQUAL:
-		case COMPILER_OP_CODE_LONG_EQUAL:
-		case COMPILER_OP_CODE_FLOAT_EQUAL: {
-			static const char* comp_prop[] = {
-				"ip",
-				"bool_flag",
-				"char_int",
-				"long_int",
-				"float_int"
-			};
-
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".bool_flag = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".%s == ", comp_prop[instructions[i].op_code - COMPILER_OP_CODE_PTR_EQUAL]);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".%s;", comp_prop[instructions[i].op_code - COMPILER_OP_CODE_PTR_EQUAL]);
-			break;
 		}
-		case COMPILER_OP_CODE_LONG_MORE:
-		case COMPILER_OP_CODE_LONG_LESS:
-		case COMPILER_OP_CODE_LONG_MORE_EQUAL:
-		case COMPILER_OP_CODE_LONG_LESS_EQUAL:
-		case COMPILER_OP_CODE_LONG_ADD:
-		case COMPILER_OP_CODE_LONG_SUBTRACT:
-		case COMPILER_OP_CODE_LONG_MULTIPLY:
-		case COMPILER_OP_CODE_LONG_DIVIDE:
-		case COMPILER_OP_CODE_LONG_MODULO:
-		case COMPILER_OP_CODE_LONG_EXPONENTIATE:
-		case COMPILER_OP_CODE_FLOAT_MORE:
-		case COMPILER_OP_CODE_FLOAT_LESS:
-		case COMPILER_OP_CODE_FLOAT_MORE_EQUAL:
-		case COMPILER_OP_CODE_FLOAT_LESS_EQUAL:
-		case COMPILER_OP_CODE_FLOAT_ADD:
-		case COMPILER_OP_CODE_FLOAT_SUBTRACT:
-		case COMPILER_OP_CODE_FLOAT_MULTIPLY:
-		case COMPILER_OP_CODE_FLOAT_DIVIDE: {
-			const char* operators[] = {
-				">", "<", ">=", "<=", "+", "-", "*", "/", "%"
-			};
-			const int set_vals[] = {
-				0, 0, 0, 0, 1, 1, 1, 1, 1
-			};
-
-			int op_id = (instructions[i].op_code - COMPILER_OP_CODE_LONG_MORE) % (COMPILER_OP_CODE_FLOAT_MORE - COMPILER_OP_CODE_LONG_MORE);
-			const char* type = num_types[instructions[i].op_code >= COMPILER_OP_CODE_FLOAT_MORE];
-
-			if (op_id <= (COMPILER_OP_CODE_LONG_DIVIDE - COMPILER_OP_CODE_LONG_MORE) || instructions[i].op_code == COMPILER_OP_CODE_LONG_MODULO) {
-				if (instructions[i].op_code == COMPILER_OP_CODE_LONG_DIVIDE) {
-					fputs("PANIC_ON_FAIL(", file_out);
-					emit_reg(file_out, instructions[i].regs[1], 0);
-					fprintf(file_out, ".long_int, CISH_ERROR_DIVIDE_BY_ZERO, %"PRIu64");", src_loc_id);
-				}
-				emit_reg(file_out, instructions[i].regs[2], 0);
-				fprintf(file_out, ".%s = ", set_vals[op_id] ? type : "bool_flag");
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fprintf(file_out, ".%s %s ", type, operators[op_id]);
-				emit_reg(file_out, instructions[i].regs[1], 0);
-				fprintf(file_out, ".%s;", type);
-			}
-			else if (instructions[i].op_code < COMPILER_OP_CODE_FLOAT_MORE) {
-				emit_reg(file_out, instructions[i].regs[2], 0);
-				fputs(".long_int = longpow(", file_out);
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fputs(".long_int, ", file_out);
+		if (compiler) {
+			fputs("return ", file_out);
+			emit_proc_function(file_out, compiler, instructions[i].regs[0]);
+			fputs("(fp);", file_out);
+		}
+		else
+			fputs("goto *scratch_ptr;", file_out);
+		break;
+	case COMPILER_OP_CODE_RETURN:
+		if (compiler)
+			fputs("return 1;", file_out);
+		else
+			fputs("goto *(positions[--position_count]);", file_out);
+		break;
+	case COMPILER_OP_CODE_STACK_VALIDATE:
+		fprintf(file_out, "STACK_CHECK(global_offset + %"PRIu32", %"PRIu64");", instructions[i].regs[0].reg, src_loc_id);
+		break;
+	case COMPILER_OP_CODE_LABEL:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		if (compiler)
+			fprintf(file_out, ".ip = (void*)proc%"PRIu16";", find_callee(compiler, instructions[i].regs[0]));
+		else
+			fprintf(file_out, ".ip = &&label%"PRIu32";", label_buf->ins_label[instructions[i].regs[1].reg]);
+		break;
+	case COMPILER_OP_CODE_LOAD_ALLOC:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT:
+		//set scratchepads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+		fputs("scratch_i = ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int;", file_out);
+
+		//bounds check
+		if (instructions[i].op_code == COMPILER_OP_CODE_LOAD_ALLOC || instructions[i].op_code == COMPILER_OP_CODE_LOAD_ALLOC_INIT)
+			fprintf(file_out, "PANIC_ON_FAIL(scratch_i < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", src_loc_id);
+		//mem init check
+		if (instructions[i].op_code == COMPILER_OP_CODE_LOAD_ALLOC || instructions[i].op_code == COMPILER_OP_CODE_LOAD_ALLOC_INBOUND)
+			fprintf(file_out, "PANIC_ON_FAIL(STAT_GET(((heap_alloc_t*)scratch_ptr)->init_stat, scratch_i), CISH_ERROR_READ_UNINIT, %"PRIu64");", src_loc_id);
+
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(" = ((heap_alloc_t*)scratch_ptr)->registers[scratch_i];", file_out);
+		break;
+	case COMPILER_OP_CODE_LOAD_ALLOC_I:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_INIT:
+		//set scratchepads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+
+		//mem init check
+		if (instructions[i].op_code == COMPILER_OP_CODE_LOAD_ALLOC_I)
+			fprintf(file_out, "PANIC_ON_FAIL(STAT_GET(((heap_alloc_t*)scratch_ptr)->init_stat, %"PRIu32"), CISH_ERROR_READ_UNINIT, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, " = ((heap_alloc_t*)scratch_ptr)->registers[%"PRIu32"];", instructions[i].regs[2].reg);
+		break;
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
+		//set scratchepads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+
+		//bounds check
+		fprintf(file_out, "PANIC_ON_FAIL(%"PRIu32" < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+
+		//mem init check
+		fprintf(file_out, "PANIC_ON_FAIL(STAT_GET(((heap_alloc_t*)scratch_ptr)->init_stat, %"PRIu32"), CISH_ERROR_READ_UNINIT, %"PRIu64"); ", instructions[i].regs[2].reg, src_loc_id);
+
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, " = ((heap_alloc_t*)scratch_ptr)->registers[%"PRIu32"];", instructions[i].regs[2].reg);
+		break;
+	case COMPILER_OP_CODE_STORE_ALLOC:
+	case COMPILER_OP_CODE_STORE_ALLOC_INBOUND:
+		//set scratchpads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+		fputs("scratch_i = ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int;", file_out);
+
+		//bounds check
+		if (instructions[i].op_code == COMPILER_OP_CODE_STORE_ALLOC)
+			fprintf(file_out, "PANIC_ON_FAIL(scratch_i < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", src_loc_id);
+
+		//record old-to-young writes
+		fprintf(file_out, "GC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, %"PRIu64");", src_loc_id);
+
+		//count references in reference counting mode
+		fputs("RC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, scratch_i, ", file_out);
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fprintf(file_out, ", %"PRIu64");", src_loc_id);
+
+		//set mem init status
+		fputs("STAT_SET(((heap_alloc_t*)scratch_ptr)->init_stat, scratch_i);", file_out);
+		fputs("((heap_alloc_t*)scratch_ptr)->registers[scratch_i] = ", file_out);
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputc(';', file_out);
+		break;
+	case COMPILER_OP_CODE_STORE_ALLOC_I:
+		//set scratchpads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+
+		//record old-to-young writes
+		fprintf(file_out, "GC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, %"PRIu64");", src_loc_id);
+
+		//count references in reference counting mode
+		fprintf(file_out, "RC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, %"PRIu32", ", instructions[i].regs[2].reg);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ", %"PRIu64");", src_loc_id);
+
+		//set mem init status
+		fprintf(file_out, "STAT_SET(((heap_alloc_t*)scratch_ptr)->init_stat, %"PRIu32");", instructions[i].regs[2].reg);
+
+		fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->registers[%"PRIu32"] = ", instructions[i].regs[2].reg);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputc(';', file_out);
+		break;
+	case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
+		//set scratchpads
+		fputs("scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+
+		//bounds check
+		fprintf(file_out, "PANIC_ON_FAIL(%"PRIu32" < ((heap_alloc_t*)scratch_ptr)->limit, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+
+		//record old-to-young writes
+		fprintf(file_out, "GC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, %"PRIu64");", src_loc_id);
+
+		//count references in reference counting mode
+		fprintf(file_out, "RC_WRITE_BARRIER((heap_alloc_t*)scratch_ptr, %"PRIu32", ", instructions[i].regs[2].reg);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ", %"PRIu64");", src_loc_id);
+
+		//set mem init status
+		fprintf(file_out, "STAT_SET(((heap_alloc_t*)scratch_ptr)->init_stat, %"PRIu32");", instructions[i].regs[2].reg);
+
+		fprintf(file_out, "((heap_alloc_t*)scratch_ptr)->registers[%"PRIu32"] = ", instructions[i].regs[2].reg);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputc(';', file_out);
+		break;
+	case COMPILER_OP_CODE_CONF_TRACE:
+		fputs("STAT_ASSIGN(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->trace_stat, %"PRIu32", %"PRIu32");", instructions[i].regs[1].reg, instructions[i].regs[2].reg);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_CONF:
+		fputs("STAT_ASSIGN(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->trace_stat, %"PRIu32", defined_signatures[", instructions[i].regs[1].reg);
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".long_int].super_signature >= 9);", file_out);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_CONF_ALL:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->trace_mode = (defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 9);", file_out);
+		break;
+	case COMPILER_OP_CODE_STACK_OFFSET:
+		fprintf(file_out, "global_offset += %"PRIu32"; fp += %"PRIu32";", instructions[i].regs[0].reg, instructions[i].regs[0].reg);
+		fputs("RUNTIME_STATS_PEAK(peak_global_offset, global_offset);", file_out);
+		break;
+	case COMPILER_OP_CODE_STACK_DEOFFSET:
+		fprintf(file_out, "global_offset -= %"PRIu32"; fp -= %"PRIu32";", instructions[i].regs[0].reg, instructions[i].regs[0].reg);
+		break;
+	case COMPILER_OP_CODE_ALLOC:
+		//array lengths are longs, but heap allocations are limited to 32-bit lengths
+		fputs("scratch_i = ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".long_int; PANIC_ON_FAIL(scratch_i >= 0 && scratch_i <= UINT32_MAX, CISH_ERROR_INDEX_OUT_OF_RANGE, %"PRIu64");", src_loc_id);
+		fprintf(file_out, "HEAP_PROFILE_LOC(%"PRIu64");", src_loc_id);
+		fputs("PANIC_ON_FAIL(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc = alloc((uint32_t)scratch_i, %"PRIu32"), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+		break;
+	case COMPILER_OP_CODE_ALLOC_I:
+	case COMPILER_OP_CODE_ALLOC_I_INIT:
+		fprintf(file_out, "HEAP_PROFILE_LOC(%"PRIu64");", src_loc_id);
+		fputs("ALLOC_I_FAST(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc, %"PRIu32", %"PRIu32", %i, %"PRIu64");", instructions[i].regs[1].reg, instructions[i].regs[2].reg, instructions[i].op_code == COMPILER_OP_CODE_ALLOC_I, src_loc_id);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_FREE:
+		fputs("if(defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 9) { ", file_out);
+	case COMPILER_OP_CODE_FREE:
+		fputs("PANIC_ON_FAIL(free_alloc(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		if (instructions[i].op_code == COMPILER_OP_CODE_DYNAMIC_FREE)
+			fputc('}', file_out);
+		break;
+	case COMPILER_OP_CODE_RC_RELEASE:
+		fputs("PANIC_ON_FAIL(rc_release_local(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_GC_NEW_FRAME:
+		fprintf(file_out, "FRAME_CHECK(heap_frame, %"PRIu64");"
+			"heap_frame_bounds[heap_frame] = heap_count;"
+			"trace_frame_bounds[heap_frame] = trace_count;"
+			"remembered_frame_bounds[heap_frame] = remembered_count;"
+			"heap_frame++;"
+			"GC_FRAME_EPOCH;", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_GC_TRACE:
+		fputs("TRACE_COUNT_CHECK; (heap_traces[trace_count++] = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc)->gc_flag = %"PRIu32";", instructions[i].regs[1].reg);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TRACE:
+		fputs("TRACE_COUNT_CHECK; (heap_traces[trace_count++] = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc)->gc_flag = (defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 9);", file_out);
+		break;
+	case COMPILER_OP_CODE_GC_CLEAN:
+		fprintf(file_out, "PANIC_ON_FAIL(gc_clean(), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_AND:
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".bool_flag = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag && ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".bool_flag;", file_out);
+		break;
+	case COMPILER_OP_CODE_OR:
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".bool_flag = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag || ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".bool_flag;", file_out);
+		break;
+	case COMPILER_OP_CODE_NOT:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag = !", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".bool_flag;", file_out);
+		break;
+	case COMPILER_OP_CODE_LENGTH:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".long_int = ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".heap_alloc->limit;", file_out);
+		break;
+	case COMPILER_OP_CODE_PTR_EQUAL:
+	case COMPILER_OP_CODE_BOOL_EQUAL:
+	case COMPILER_OP_CODE_CHAR_EQUAL:
+	case COMPILER_OP_CODE_LONG_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_EQUAL: {
+		static const char* comp_prop[] = {
+			"ip",
+			"bool_flag",
+			"char_int",
+			"long_int",
+			"float_int"
+		};
+
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".bool_flag = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".%s == ", comp_prop[instructions[i].op_code - COMPILER_OP_CODE_PTR_EQUAL]);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".%s;", comp_prop[instructions[i].op_code - COMPILER_OP_CODE_PTR_EQUAL]);
+		break;
+	}
+	case COMPILER_OP_CODE_LONG_MORE:
+	case COMPILER_OP_CODE_LONG_LESS:
+	case COMPILER_OP_CODE_LONG_MORE_EQUAL:
+	case COMPILER_OP_CODE_LONG_LESS_EQUAL:
+	case COMPILER_OP_CODE_LONG_ADD:
+	case COMPILER_OP_CODE_LONG_SUBTRACT:
+	case COMPILER_OP_CODE_LONG_MULTIPLY:
+	case COMPILER_OP_CODE_LONG_DIVIDE:
+	case COMPILER_OP_CODE_LONG_MODULO:
+	case COMPILER_OP_CODE_LONG_EXPONENTIATE:
+	case COMPILER_OP_CODE_FLOAT_MORE:
+	case COMPILER_OP_CODE_FLOAT_LESS:
+	case COMPILER_OP_CODE_FLOAT_MORE_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_LESS_EQUAL:
+	case COMPILER_OP_CODE_FLOAT_ADD:
+	case COMPILER_OP_CODE_FLOAT_SUBTRACT:
+	case COMPILER_OP_CODE_FLOAT_MULTIPLY:
+	case COMPILER_OP_CODE_FLOAT_DIVIDE: {
+		const char* operators[] = {
+			">", "<", ">=", "<=", "+", "-", "*", "/", "%"
+		};
+		const int set_vals[] = {
+			0, 0, 0, 0, 1, 1, 1, 1, 1
+		};
+
+		int op_id = (instructions[i].op_code - COMPILER_OP_CODE_LONG_MORE) % (COMPILER_OP_CODE_FLOAT_MORE - COMPILER_OP_CODE_LONG_MORE);
+		const char* type = num_types[instructions[i].op_code >= COMPILER_OP_CODE_FLOAT_MORE];
+
+		if (op_id <= (COMPILER_OP_CODE_LONG_DIVIDE - COMPILER_OP_CODE_LONG_MORE) || instructions[i].op_code == COMPILER_OP_CODE_LONG_MODULO) {
+			if (instructions[i].op_code == COMPILER_OP_CODE_LONG_DIVIDE) {
+				fputs("PANIC_ON_FAIL(", file_out);
 				emit_reg(file_out, instructions[i].regs[1], 0);
-				fputs(".long_int);", file_out);
+				fprintf(file_out, ".long_int, CISH_ERROR_DIVIDE_BY_ZERO, %"PRIu64");", src_loc_id);
 			}
-			break;
-		}
-		case COMPILER_OP_CODE_FLOAT_MODULO:
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".float_int = fmod(", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".float_int, ", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".float_int);", file_out);
-			break;
-		case COMPILER_OP_CODE_FLOAT_EXPONENTIATE:
 			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".float_int = pow(", file_out);
+			fprintf(file_out, ".%s = ", set_vals[op_id] ? type : "bool_flag");
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".float_int, ", file_out);
+			fprintf(file_out, ".%s %s ", type, operators[op_id]);
 			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".float_int);", file_out);
-			break;
-		case COMPILER_OP_CODE_LONG_NEGATE:
-		case COMPILER_OP_CODE_FLOAT_NEGATE:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".%s = -", num_types[instructions[i].op_code == COMPILER_OP_CODE_FLOAT_NEGATE]);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".%s;", num_types[instructions[i].op_code == COMPILER_OP_CODE_FLOAT_NEGATE]);
-			break;
-		case COMPILER_OP_CODE_LONG_INCREMENT:
-		case COMPILER_OP_CODE_LONG_DECREMENT:
-		case COMPILER_OP_CODE_FLOAT_INCREMENT:
-		case COMPILER_OP_CODE_FLOAT_DECREMENT:{
-			static char* operators[] = {
-				"++", "--"
-			};
-			fprintf(file_out, "%s", operators[(instructions[i].op_code - COMPILER_OP_CODE_LONG_INCREMENT) % 2]);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".%s;", num_types[instructions[i].op_code >= COMPILER_OP_CODE_FLOAT_INCREMENT]);
-			break;
+			fprintf(file_out, ".%s;", type);
 		}
-		case COMPILER_OP_CODE_CONFIG_TYPESIG:
-			if (instructions[i].regs[2].reg) {
-				fprintf(file_out, "PANIC_ON_FAIL(scratch_ptr = malloc(sizeof(machine_type_sig_t)), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-				fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu16"], (machine_type_sig_t*)scratch_ptr, 1), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[1].reg, src_loc_id);
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fputs(".heap_alloc->type_sig = (machine_type_sig_t*)scratch_ptr;", file_out);
-			}
-			else {
-				emit_reg(file_out, instructions[i].regs[0], 0);
-				fprintf(file_out, ".heap_alloc->type_sig = &defined_signatures[%"PRIu16"];", instructions[i].regs[1].reg);
-			}
-			break;
-		case COMPILER_OP_CODE_RUNTIME_TYPECHECK:
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".bool_flag = type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, defined_signatures[%"PRIu16"]);", instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_RUNTIME_TYPECAST:
-			fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, defined_signatures[%"PRIu16"]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".heap_alloc = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc;", file_out);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DD:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag = type_signature_match(defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 10 ? *", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int], defined_signatures[", file_out);
+		else if (instructions[i].op_code < COMPILER_OP_CODE_FLOAT_MORE) {
 			emit_reg(file_out, instructions[i].regs[2], 0);
-			fputs(".long_int]);", file_out);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DR:
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag = type_signature_match(defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 10 ? *", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".long_int], defined_signatures[%"PRIu16"]);", instructions[i].regs[2].reg);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_RD:
+			fputs(".long_int = longpow(", file_out);
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".bool_flag = type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig, defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int]);", file_out);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DD:
-			fputs("PANIC_ON_FAIL(type_signature_match(defined_signatures[", file_out);
+			fputs(".long_int, ", file_out);
 			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 10 ? *", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int], defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[2], 0);
-			fprintf(file_out, ".long_int]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DR:
-			fputs("PANIC_ON_FAIL(type_signature_match(defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".long_int].super_signature >= 10 ? *", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".long_int], defined_signatures[%"PRIu16"]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64"); ", instructions[i].regs[2].reg, src_loc_id);
-			break;
-		case COMPILER_OP_CODE_DYNAMIC_TYPECAST_RD:
-			fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig, defined_signatures[", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".long_int]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_TYPEGUARD_PROTECT_ARRAY:
-			fputs("if(((machine_type_sig_t*)(scratch_ptr = ", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fputs(".heap_alloc->type_sig->sub_types))->super_signature > 10) ", file_out);
-			fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, *((machine_type_sig_t*)scratch_ptr)), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY:
-			fputs("if((scratch_sig = ", file_out);
+			fputs(".long_int);", file_out);
+		}
+		break;
+	}
+	case COMPILER_OP_CODE_LONG_DIVIDE_NONZERO:
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".long_int = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".long_int / ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int;", file_out);
+		break;
+	case COMPILER_OP_CODE_FLOAT_MODULO:
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".float_int = fmod(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".float_int, ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".float_int);", file_out);
+		break;
+	case COMPILER_OP_CODE_FLOAT_EXPONENTIATE:
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".float_int = pow(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".float_int, ", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".float_int);", file_out);
+		break;
+	case COMPILER_OP_CODE_LONG_NEGATE:
+	case COMPILER_OP_CODE_FLOAT_NEGATE:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".%s = -", num_types[instructions[i].op_code == COMPILER_OP_CODE_FLOAT_NEGATE]);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".%s;", num_types[instructions[i].op_code == COMPILER_OP_CODE_FLOAT_NEGATE]);
+		break;
+	case COMPILER_OP_CODE_LONG_INCREMENT:
+	case COMPILER_OP_CODE_LONG_DECREMENT:
+	case COMPILER_OP_CODE_FLOAT_INCREMENT:
+	case COMPILER_OP_CODE_FLOAT_DECREMENT:{
+		static char* operators[] = {
+			"++", "--"
+		};
+		fprintf(file_out, "%s", operators[(instructions[i].op_code - COMPILER_OP_CODE_LONG_INCREMENT) % 2]);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".%s;", num_types[instructions[i].op_code >= COMPILER_OP_CODE_FLOAT_INCREMENT]);
+		break;
+	}
+	case COMPILER_OP_CODE_CONFIG_TYPESIG:
+		if (instructions[i].regs[2].reg) {
+			fprintf(file_out, "PANIC_ON_FAIL(scratch_ptr = malloc(sizeof(machine_type_sig_t)), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+			fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu32"], (machine_type_sig_t*)scratch_ptr, 1), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[1].reg, src_loc_id);
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig->sub_types[%"PRIu16"]).super_signature >= 9)", instructions[i].regs[2].reg);
-			fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, scratch_sig), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			break;
-		case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY_DOWNCAST:
-			fputs("PANIC_ON_FAIL(atomize_heap_type_sig(*", file_out);
+			fputs(".heap_alloc->type_sig = (machine_type_sig_t*)scratch_ptr;", file_out);
+		}
+		else {
 			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, &scratch_sig, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			fprintf(file_out, "PANIC_ON_FAIL(downcast_type_signature(&scratch_sig, %"PRIu16"), CISH_ERROR_MEMORY, %"PRIu64");"
-							  "aux_sig2 = scratch_sig.sub_types[%"PRIu16"];", extra_a, src_loc_id, instructions[i].regs[2].reg);
+			fprintf(file_out, ".heap_alloc->type_sig = &defined_signatures[%"PRIu32"];", instructions[i].regs[1].reg);
+		}
+		break;
+	case COMPILER_OP_CODE_RUNTIME_TYPECHECK:
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".bool_flag = type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, defined_signatures[%"PRIu32"]);", instructions[i].regs[2].reg);
+		break;
+	case COMPILER_OP_CODE_RUNTIME_TYPECAST:
+		fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, defined_signatures[%"PRIu32"]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".heap_alloc = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc;", file_out);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DD:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag = type_signature_match(defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 10 ? *", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int], defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fputs(".long_int]);", file_out);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_DR:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag = type_signature_match(defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 10 ? *", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".long_int], defined_signatures[%"PRIu32"]);", instructions[i].regs[2].reg);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECHECK_RD:
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".bool_flag = type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig, defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int]);", file_out);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DD:
+		fputs("PANIC_ON_FAIL(type_signature_match(defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 10 ? *", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int], defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[2], 0);
+		fprintf(file_out, ".long_int]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_DR:
+		fputs("PANIC_ON_FAIL(type_signature_match(defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".long_int].super_signature >= 10 ? *", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig : defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".long_int], defined_signatures[%"PRIu32"]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64"); ", instructions[i].regs[2].reg, src_loc_id);
+		break;
+	case COMPILER_OP_CODE_DYNAMIC_TYPECAST_RD:
+		fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig, defined_signatures[", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".long_int]), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_ARRAY:
+		fputs("if(((machine_type_sig_t*)(scratch_ptr = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fputs(".heap_alloc->type_sig->sub_types))->super_signature > 10) ", file_out);
+		fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, *((machine_type_sig_t*)scratch_ptr)), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY:
+		fputs("if((scratch_sig = ", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig->sub_types[%"PRIu32"]).super_signature >= 9)", instructions[i].regs[2].reg);
+		fputs("PANIC_ON_FAIL(type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, scratch_sig), CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		break;
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_TYPEARG_PROPERTY_DOWNCAST:
+		fputs("PANIC_ON_FAIL(atomize_heap_type_sig(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, &scratch_sig, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		fprintf(file_out, "PANIC_ON_FAIL(downcast_type_signature(&scratch_sig, %"PRIu32"), CISH_ERROR_MEMORY, %"PRIu64");"
+						  "aux_sig2 = scratch_sig.sub_types[%"PRIu32"];", extra_a, src_loc_id, instructions[i].regs[2].reg);
+
+		fputs("if(aux_sig2.super_signature >= 9 && !type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, aux_sig2)) { "
+			"free_type_signature(&scratch_sig);"
+			"PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		fputs("} free_type_signature(&scratch_sig);", file_out);
+		break;
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY:
+		fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu32"], &scratch_sig, 0), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+		fputs("PANIC_ON_FAIL(get_super_type(", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig->sub_types, &scratch_sig), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		fputs("if(!type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".heap_alloc->type_sig, scratch_sig)) { free_type_signature(&scratch_sig); ", file_out);
+		fprintf(file_out, "PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		fputs("}; free_type_signature(&scratch_sig);", file_out);
+		break;
+	case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY_DOWNCAST:
+		fputs("PANIC_ON_FAIL(atomize_heap_type_sig(*", file_out);
+		emit_reg(file_out, instructions[i].regs[0], 0);
+		fprintf(file_out, ".heap_alloc->type_sig, &aux_sig2, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		fprintf(file_out, "PANIC_ON_FAIL(downcast_type_signature(&aux_sig2, %"PRIu32"), CISH_ERROR_MEMORY, %"PRIu64");", extra_a, src_loc_id);
+
+		fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu32"], &scratch_sig, 0), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
+		fprintf(file_out, "PANIC_ON_FAIL(get_super_type(aux_sig2.sub_types, &scratch_sig), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
+		fputs("if(!type_signature_match(*", file_out);
+		emit_reg(file_out, instructions[i].regs[1], 0);
+		fputs(".heap_alloc->type_sig, scratch_sig)) { free_type_signature(&scratch_sig); free_type_signature(&aux_sig2);", file_out);
+		fprintf(file_out, "PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
+		fputs("}; free_type_signature(&scratch_sig); free_type_signature(&aux_sig2);", file_out);
+		break;
+	default:
+		return 0;
+	}
+	fputc('\n', file_out);
+	return 1;
+}
 
-			fputs("if(aux_sig2.super_signature >= 9 && !type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, aux_sig2)) { "
-				"free_type_signature(&scratch_sig);"
-				"PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			fputs("} free_type_signature(&scratch_sig);", file_out);
-			break;
-		case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY:
-			fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu16"], &scratch_sig, 0), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-			fputs("PANIC_ON_FAIL(get_super_type(", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig->sub_types, &scratch_sig), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			fputs("if(!type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".heap_alloc->type_sig, scratch_sig)) { free_type_signature(&scratch_sig); ", file_out);
-			fprintf(file_out, "PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			fputs("}; free_type_signature(&scratch_sig);", file_out);
-			break;
-		case COMPILER_OP_CODE_TYPEGUARD_PROTECT_SUB_PROPERTY_DOWNCAST:
-			fputs("PANIC_ON_FAIL(atomize_heap_type_sig(*", file_out);
-			emit_reg(file_out, instructions[i].regs[0], 0);
-			fprintf(file_out, ".heap_alloc->type_sig, &aux_sig2, 1), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			fprintf(file_out, "PANIC_ON_FAIL(downcast_type_signature(&aux_sig2, %"PRIu16"), CISH_ERROR_MEMORY, %"PRIu64");", extra_a, src_loc_id);
 
-			fprintf(file_out, "PANIC_ON_FAIL(atomize_heap_type_sig(defined_signatures[%"PRIu16"], &scratch_sig, 0), CISH_ERROR_MEMORY, %"PRIu64");", instructions[i].regs[2].reg, src_loc_id);
-			fprintf(file_out, "PANIC_ON_FAIL(get_super_type(aux_sig2.sub_types, &scratch_sig), CISH_ERROR_MEMORY, %"PRIu64");", src_loc_id);
-			fputs("if(!type_signature_match(*", file_out);
-			emit_reg(file_out, instructions[i].regs[1], 0);
-			fputs(".heap_alloc->type_sig, scratch_sig)) { free_type_signature(&scratch_sig); free_type_signature(&aux_sig2);", file_out);
-			fprintf(file_out, "PANIC(CISH_ERROR_UNEXPECTED_TYPE, %"PRIu64");", src_loc_id);
-			fputs("}; free_type_signature(&scratch_sig); free_type_signature(&aux_sig2);", file_out);
-			break;
-		default:
-			return 0;
+//emits instructions in [start, end), leaving out the bodies of nested procs when they're emitted as their own c functions
+static int emit_instruction_range(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t start, uint64_t end, int dbg, dbg_table_t* dbg_table, local_lowering_t* lowering, compiler_t* compiler, uint16_t emitting_proc) {
+	for (uint_fast64_t i = start; i < end; i++) {
+		ESCAPE_ON_FAIL(emit_instruction(file_out, label_buf, instructions, i, dbg, dbg_table, lowering, compiler, emitting_proc));
+		if (compiler && instructions[i].op_code == COMPILER_OP_CODE_LABEL)
+			i = instructions[i + 1].regs[0].reg - 1; //skip the jump over the body too, since the proc's label now holds a function pointer
+	}
+	return 1;
+}
+
+int emit_instructions(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t count, int dbg, dbg_table_t* dbg_table, local_lowering_t* lowering, compiler_t* proc_functions) {
+	static const char* scratch_decls = "void* scratch_ptr; int64_t scratch_i; machine_type_sig_t scratch_sig, aux_sig2;";
+
+	if (proc_functions) {
+		uint32_t* proc_label_ips = proc_functions->proc_label_ips;
+
+		fputc('\n', file_out);
+		for (uint_fast16_t proc = 0; proc < proc_functions->proc_count; proc++)
+			if (proc_label_ips[proc] != UINT32_MAX)
+				fprintf(file_out, "static int proc%"PRIuFAST16"(machine_reg_t* fp);\n", proc);
+
+		for (uint_fast16_t proc = 0; proc < proc_functions->proc_count; proc++) {
+			if (proc_label_ips[proc] == UINT32_MAX)
+				continue;
+			uint64_t end = instructions[proc_label_ips[proc] + 1].regs[0].reg;
+
+			fprintf(file_out, "\n//runs proc %"PRIuFAST16"\nstatic int proc%"PRIuFAST16"(machine_reg_t* fp) {\n\t%s ", proc, proc, scratch_decls);
+			if (lowering)
+				emit_local_decls(file_out, lowering, proc);
+			fputc('\n', file_out);
+			ESCAPE_ON_FAIL(emit_instruction_range(file_out, label_buf, instructions, proc_label_ips[proc] + 2, end, dbg, dbg_table, lowering, proc_functions, proc));
+
+			//every code path returns before the end of a proc, but jumps past its last statement still need a target
+			if (label_buf->ins_label[end])
+				fprintf(file_out, "label%"PRIu32":\n", label_buf->ins_label[end]);
+			fputs("\treturn 1;\n}\n", file_out);
 		}
-		
+	}
+
+	fprintf(file_out, "\n//runs the instructions\nstatic int run() {\n\t%s machine_reg_t* fp = &stack[global_offset];\n", scratch_decls);
+	if (lowering && !proc_functions) {
+		fputc('\t', file_out);
+		for (uint_fast16_t proc = 0; proc < lowering->proc_count; proc++)
+			emit_local_decls(file_out, lowering, proc);
 		fputc('\n', file_out);
 	}
+	ESCAPE_ON_FAIL(emit_instruction_range(file_out, label_buf, instructions, 0, count, dbg, dbg_table, lowering, proc_functions, UINT16_MAX));
 	fputs("}\n", file_out);
 	return 1;
 }
 
-void emit_final(FILE* file_out, int robo_mode, int debug, const char* input_file) {
+void emit_final(FILE* file_out, int robo_mode, int debug, int stats, int heap_profile, const char* input_file) {
 	if (robo_mode) {
 		pros_emit_info(file_out, input_file);
 		pros_emit_events(file_out, debug);
 	}
 	else {
-		if (debug) 
-			fputs("\nint main() {\n"
+		fputs("\nint main() {\n"
 			"\tif(!init_all()) {\n\t\texit(EXIT_FAILURE);\n\t}\n"
-			"\tif(!run()) {\n"
-			"\t\tprint_back_trace();\n"
-			"\t\tprintf(\"Runtime Error: %s\", error_names[last_err]);\n"
-			"\t\tfree_runtime();\n"
+			"\tif(!run()) {\n", file_out);
+		if (debug)
+			fputs("\t\tprint_back_trace();\n", file_out);
+		fputs("\t\tprintf(\"Runtime Error: %s\", error_names[last_err]);\n", file_out);
+		if (stats)
+			fputs("\t\tprint_runtime_stats();\n", file_out);
+		if (heap_profile)
+			fputs("\t\tprint_heap_profile();\n", file_out);
+		fputs("\t\tfree_runtime();\n"
 			"\t\texit(EXIT_FAILURE);\n"
-			"\t}\n"
-			"\tfree_runtime();\n"
+			"\t}\n", file_out);
+		if (stats)
+			fputs("\tprint_runtime_stats();\n", file_out);
+		if (heap_profile)
+			fputs("\tprint_heap_profile();\n", file_out);
+		fputs("\tfree_runtime();\n"
 			"\texit(EXIT_SUCCESS);\n"
 			"}", file_out);
-		else
-			fputs("\nint main() {\n"
-				"\tif(!init_all()) {\n\t\texit(EXIT_FAILURE);\n\t}\n"
-				"\tif(!run()) {\n"
-				"\t\tprintf(\"Runtime Error: %s\", error_names[last_err]);\n"
-				"\t\tfree_runtime();\n"
-				"\t\texit(EXIT_FAILURE);\n"
-				"\t}\n"
-				"\tfree_runtime();\n"
-				"\texit(EXIT_SUCCESS);\n"
-				"}", file_out);
 	}
 }
\ No newline at end of file
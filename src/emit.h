@@ -10,11 +10,47 @@
 #include "compiler.h"
 #include "ast.h"
 #include "labels.h"
+#include "locals.h"
 
-int emit_c_header(FILE* fileout, int robo_mode, int dbg);
+//runtime tables whose initial capacities a capacity profile sets, emit_c_header gives the generated runtime the same list
+#define RUNTIME_TABLES(X) \
+	X(HEAP_ALLOCS, heap_allocs) \
+	X(HEAP_TRACES, heap_traces) \
+	X(RESET_STACK, reset_stack) \
+	X(MARK_STACK, mark_stack) \
+	X(REMEMBERED, heap_remembered)
+
+#define RUNTIME_TABLE_ENUM(TABLE, NAME) RUNTIME_TABLE_##TABLE,
+typedef enum runtime_table {
+	RUNTIME_TABLES(RUNTIME_TABLE_ENUM)
+	RUNTIME_TABLE_COUNT
+} runtime_table_t;
+#undef RUNTIME_TABLE_ENUM
+
+//the runtime features, and their settings, that emit_c_header configures the generated runtime with
+typedef struct runtime_options {
+	int robo_mode, debug, stats, heap_profile;
+
+	int rc_mode;
+	uint32_t rc_threshold; //how many candidates are buffered before they're collected, the runtime's default if 0
+	uint32_t rc_frame_span; //how many registers past a frame pointer may be live
+
+	uint32_t gc_step_budget; //incremental gc is off if 0
+	int gc_step_micros; //whether the step budget is in microseconds rather than objects
+
+	uint32_t stack_size; //the runtime's defaults are used if 0
+	uint16_t frame_limit;
+	int growable_stack;
+
+	const char* capacity_profile; //where runtime table high-water marks are written, if anywhere
+} runtime_options_t;
+
+int read_capacity_profile(uint32_t* capacities, const char* path);
+
+int emit_c_header(FILE* fileout, runtime_options_t* options);
 void emit_constants(FILE* file_out, ast_t* ast, machine_t* machine);
 int emit_debug_info(FILE* file_out, dbg_table_t* dbg_table, label_buf_t* label_buf);
-int emit_init(FILE* file_out, ast_t* ast, machine_t* machine, int dbg);
-int emit_instructions(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t count, int dbg, dbg_table_t* dbg_table);
-void emit_final(FILE* file_out, int robo_mode, int debug, const char* input_file);
+int emit_init(FILE* file_out, ast_t* ast, machine_t* machine, int dbg, int heap_profile, uint32_t* capacities);
+int emit_instructions(FILE* file_out, label_buf_t* label_buf, compiler_ins_t* instructions, uint64_t count, int dbg, dbg_table_t* dbg_table, local_lowering_t* lowering, compiler_t* proc_functions);
+void emit_final(FILE* file_out, int robo_mode, int debug, int stats, int heap_profile, const char* input_file);
 #endif // !EMIT_H
\ No newline at end of file
@@ -0,0 +1,380 @@
+#include <stdlib.h>
+#include <math.h>
+#include "fold.h"
+
+#define REG_EQ(A, B) ((A).reg == (B).reg && (A).offset == (B).offset)
+#define IS_CONSTANT(REG) (!(REG).offset && ((REG).reg < folder->compiler->ast->constant_count || (REG).reg >= FOLDED_CONSTANT_BASE))
+//capote is built with -Ofast, so nan and inf are recognized by their exponent bits rather than compared
+#define IS_FINITE(VALUE) ((((uint64_t)(VALUE).long_int >> 52) & 0x7FF) != 0x7FF)
+#define CONSTANT_VALUE(REG) ((REG).reg >= FOLDED_CONSTANT_BASE ? folder->folded[(REG).reg - FOLDED_CONSTANT_BASE] : folder->compiler->target_machine->stack[(REG).reg])
+
+//finds a constant register holding a value, making a new one if there isn't any
+static int get_constant(constant_folder_t* folder, machine_reg_t value, compiler_reg_t* out) {
+	for (uint_fast16_t i = 0; i < folder->compiler->ast->constant_count; i++)
+		if (folder->compiler->target_machine->stack[i].long_int == value.long_int) {
+			*out = (compiler_reg_t){ .reg = i, .offset = 0 };
+			return 1;
+		}
+	for (uint_fast32_t i = 0; i < folder->folded_count; i++)
+		if (folder->folded[i].long_int == value.long_int) {
+			*out = (compiler_reg_t){ .reg = FOLDED_CONSTANT_BASE + i, .offset = 0 };
+			return 1;
+		}
+
+	//constants and globals share the global registers, and are counted with 16 bits
+	if ((uint32_t)folder->compiler->ast->constant_count + folder->compiler->current_global + folder->folded_count >= UINT16_MAX)
+		return 0;
+	if (folder->folded_count == folder->alloced_folded) {
+		machine_reg_t* new_folded = safe_realloc(folder->compiler->safe_gc, folder->folded, (folder->alloced_folded *= 2) * sizeof(machine_reg_t));
+		ESCAPE_ON_FAIL(new_folded);
+		folder->folded = new_folded;
+	}
+	folder->folded[folder->folded_count] = value;
+	*out = (compiler_reg_t){ .reg = FOLDED_CONSTANT_BASE + folder->folded_count++, .offset = 0 };
+	return 1;
+}
+
+static compiler_reg_t* find_known(constant_folder_t* folder, compiler_reg_t reg) {
+	for (uint_fast8_t i = 0; i < folder->fact_count; i++)
+		if (REG_EQ(folder->facts[i].reg, reg))
+			return &folder->facts[i].constant;
+	return NULL;
+}
+
+static void forget(constant_folder_t* folder, compiler_reg_t reg) {
+	for (uint_fast8_t i = 0; i < folder->fact_count; i++)
+		if (REG_EQ(folder->facts[i].reg, reg)) {
+			folder->facts[i] = folder->facts[--folder->fact_count];
+			return;
+		}
+}
+
+static void learn(constant_folder_t* folder, compiler_reg_t reg, compiler_reg_t constant) {
+	forget(folder, reg);
+	if (folder->fact_count < MAX_FOLD_FACTS)
+		folder->facts[folder->fact_count++] = (fold_fact_t){ .reg = reg, .constant = constant };
+}
+
+//evaluates an instruction whose operands are all constants, returns the operand it writes, or -1 if it can't be evaluated at compile time
+static int evaluate(constant_folder_t* folder, compiler_ins_t ins, machine_reg_t* result) {
+	uint8_t roles[3];
+	ins_operand_roles(ins, roles);
+	if (roles[1] != OPERAND_READ)
+		return -1;
+
+	//unary operations read their second operand, and binary ones read their first two
+	machine_reg_t a = roles[0] == OPERAND_READ ? CONSTANT_VALUE(ins.regs[0]) : (machine_reg_t) { 0 };
+	machine_reg_t b = CONSTANT_VALUE(ins.regs[1]);
+	result->long_int = 0;
+
+	//float operations over non-finite values are left to the target's floating point semantics
+	if (ins.op_code == COMPILER_OP_CODE_FLOAT_NEGATE || ins.op_code == COMPILER_OP_CODE_FLOAT_EQUAL || (ins.op_code >= COMPILER_OP_CODE_FLOAT_MORE && ins.op_code <= COMPILER_OP_CODE_FLOAT_EXPONENTIATE)) {
+		if (!IS_FINITE(b) || (roles[0] == OPERAND_READ && !IS_FINITE(a)))
+			return -1;
+	}
+
+	switch (ins.op_code) {
+	case COMPILER_OP_CODE_NOT:
+		result->bool_flag = !b.bool_flag;
+		return 0;
+	case COMPILER_OP_CODE_LONG_NEGATE:
+		result->long_int = (int64_t)(0 - (uint64_t)b.long_int);
+		return 0;
+	case COMPILER_OP_CODE_FLOAT_NEGATE:
+		result->float_int = -b.float_int;
+		return 0;
+	case COMPILER_OP_CODE_AND:
+		result->bool_flag = a.bool_flag && b.bool_flag;
+		return 2;
+	case COMPILER_OP_CODE_OR:
+		result->bool_flag = a.bool_flag || b.bool_flag;
+		return 2;
+	case COMPILER_OP_CODE_BOOL_EQUAL:
+		result->bool_flag = a.bool_flag == b.bool_flag;
+		return 2;
+	case COMPILER_OP_CODE_CHAR_EQUAL:
+		result->bool_flag = a.char_int == b.char_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_EQUAL:
+		result->bool_flag = a.long_int == b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_FLOAT_EQUAL:
+		result->bool_flag = a.float_int == b.float_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_MORE:
+		result->bool_flag = a.long_int > b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_LESS:
+		result->bool_flag = a.long_int < b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_MORE_EQUAL:
+		result->bool_flag = a.long_int >= b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_LESS_EQUAL:
+		result->bool_flag = a.long_int <= b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_ADD:
+		result->long_int = (int64_t)((uint64_t)a.long_int + (uint64_t)b.long_int);
+		return 2;
+	case COMPILER_OP_CODE_LONG_SUBTRACT:
+		result->long_int = (int64_t)((uint64_t)a.long_int - (uint64_t)b.long_int);
+		return 2;
+	case COMPILER_OP_CODE_LONG_MULTIPLY:
+		result->long_int = (int64_t)((uint64_t)a.long_int * (uint64_t)b.long_int);
+		return 2;
+	case COMPILER_OP_CODE_LONG_DIVIDE:
+	case COMPILER_OP_CODE_LONG_DIVIDE_NONZERO:
+	case COMPILER_OP_CODE_LONG_MODULO:
+		//division by zero is left to fail at runtime
+		if (!b.long_int || (a.long_int == INT64_MIN && b.long_int == -1))
+			return -1;
+		result->long_int = ins.op_code == COMPILER_OP_CODE_LONG_MODULO ? a.long_int % b.long_int : a.long_int / b.long_int;
+		return 2;
+	case COMPILER_OP_CODE_LONG_EXPONENTIATE: {
+		if (b.long_int < 0)
+			return -1;
+		uint64_t base = (uint64_t)a.long_int, power = 1;
+		for (int64_t exp = b.long_int; exp; exp >>= 1) {
+			if (exp & 1)
+				power *= base;
+			base *= base;
+		}
+		result->long_int = (int64_t)power;
+		return 2;
+	}
+	case COMPILER_OP_CODE_FLOAT_MORE:
+		result->bool_flag = a.float_int > b.float_int;
+		return 2;
+	case COMPILER_OP_CODE_FLOAT_LESS:
+		result->bool_flag = a.float_int < b.float_int;
+		return 2;
+	case COMPILER_OP_CODE_FLOAT_MORE_EQUAL:
+		result->bool_flag = a.float_int >= b.float_int;
+		return 2;
+	case COMPILER_OP_CODE_FLOAT_LESS_EQUAL:
+		result->bool_flag = a.float_int <= b.float_int;
+		return 2;
+	case COMPILER_OP_CODE_FLOAT_ADD:
+		result->float_int = a.float_int + b.float_int;
+		return IS_FINITE(*result) ? 2 : -1;
+	case COMPILER_OP_CODE_FLOAT_SUBTRACT:
+		result->float_int = a.float_int - b.float_int;
+		return IS_FINITE(*result) ? 2 : -1;
+	case COMPILER_OP_CODE_FLOAT_MULTIPLY:
+		result->float_int = a.float_int * b.float_int;
+		return IS_FINITE(*result) ? 2 : -1;
+	case COMPILER_OP_CODE_FLOAT_DIVIDE:
+		result->float_int = a.float_int / b.float_int;
+		return IS_FINITE(*result) ? 2 : -1;
+	case COMPILER_OP_CODE_FLOAT_MODULO:
+		result->float_int = fmod(a.float_int, b.float_int);
+		return IS_FINITE(*result) ? 2 : -1;
+	case COMPILER_OP_CODE_FLOAT_EXPONENTIATE:
+		result->float_int = pow(a.float_int, b.float_int);
+		return IS_FINITE(*result) ? 2 : -1;
+	default:
+		return -1;
+	}
+}
+
+//propagates constants through each block, folding instructions over them and jump checks on them; returns whether anything changed
+static int fold_blocks(constant_folder_t* folder, uint8_t* leaders) {
+	compiler_ins_t* instructions = folder->compiler->ins_builder.instructions;
+	int changed = 0;
+
+	for (uint_fast32_t ip = 0; ip < folder->compiler->ins_builder.instruction_count; ip++) {
+		compiler_ins_t* ins = &instructions[ip];
+		if (leaders[ip])
+			folder->fact_count = 0;
+
+		uint8_t roles[3];
+		ins_operand_roles(*ins, roles);
+		int constant_operands = 1;
+		for (uint_fast8_t i = 0; i < 3; i++)
+			if (roles[i] == OPERAND_READ) {
+				compiler_reg_t* known = find_known(folder, ins->regs[i]);
+				if (known) {
+					ins->regs[i] = *known;
+					changed = 1;
+				}
+				constant_operands = constant_operands && IS_CONSTANT(ins->regs[i]);
+			}
+
+		switch (ins->op_code) {
+		case COMPILER_OP_CODE_JUMP_CHECK:
+			//jump checks jump when their condition is false, and otherwise fall through
+			if (IS_CONSTANT(ins->regs[0])) {
+				*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_JUMP, .regs[0] = { .reg = CONSTANT_VALUE(ins->regs[0]).bool_flag ? (uint32_t)ip + 1 : ins->regs[1].reg } };
+				changed = 1;
+			}
+			continue;
+		case COMPILER_OP_CODE_LONG_INCREMENT:
+		case COMPILER_OP_CODE_LONG_DECREMENT:
+		case COMPILER_OP_CODE_FLOAT_INCREMENT:
+		case COMPILER_OP_CODE_FLOAT_DECREMENT: {
+			compiler_reg_t* known = find_known(folder, ins->regs[0]);
+			if (known) {
+				machine_reg_t value = CONSTANT_VALUE(*known);
+				int step = (ins->op_code == COMPILER_OP_CODE_LONG_INCREMENT || ins->op_code == COMPILER_OP_CODE_FLOAT_INCREMENT) ? 1 : -1;
+				int foldable = 1;
+				if (ins->op_code <= COMPILER_OP_CODE_LONG_DECREMENT)
+					value.long_int = (int64_t)((uint64_t)value.long_int + (uint64_t)(int64_t)step);
+				else if ((foldable = IS_FINITE(value)))
+					value.float_int += step;
+
+				compiler_reg_t constant;
+				if (foldable && get_constant(folder, value, &constant)) {
+					*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_MOVE, .regs[0] = ins->regs[0], .regs[1] = constant };
+					learn(folder, ins->regs[0], constant);
+					changed = 1;
+					continue;
+				}
+			}
+			forget(folder, ins->regs[0]);
+			continue;
+		}
+		case COMPILER_OP_CODE_MOVE:
+			if (IS_CONSTANT(ins->regs[1]))
+				learn(folder, ins->regs[0], ins->regs[1]);
+			else
+				forget(folder, ins->regs[0]);
+			continue;
+		case COMPILER_OP_CODE_CALL:
+		case COMPILER_OP_CODE_TAIL_CALL:
+		case COMPILER_OP_CODE_STACK_OFFSET:
+		case COMPILER_OP_CODE_STACK_DEOFFSET:
+			//calls may write to any global, and moving the frame renames every local
+			folder->fact_count = 0;
+			continue;
+		}
+
+		machine_reg_t result;
+		int dest;
+		if (constant_operands && (dest = evaluate(folder, *ins, &result)) >= 0) {
+			compiler_reg_t constant;
+			if (get_constant(folder, result, &constant)) {
+				*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_MOVE, .regs[0] = ins->regs[dest], .regs[1] = constant };
+				learn(folder, ins->regs[0], constant);
+				changed = 1;
+				continue;
+			}
+		}
+		for (uint_fast8_t i = 0; i < 3; i++)
+			if (roles[i] & OPERAND_WRITE)
+				forget(folder, ins->regs[i]);
+	}
+	return changed;
+}
+
+//globals written only once, by a move from a constant, hold that constant wherever they can be read; returns whether anything changed
+static int fold_globals(constant_folder_t* folder) {
+	compiler_t* compiler = folder->compiler;
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint16_t constant_count = compiler->ast->constant_count;
+	if (!compiler->current_global)
+		return 0;
+
+	uint32_t* writers;
+	ESCAPE_ON_FAIL(writers = safe_malloc(compiler->safe_gc, compiler->current_global * sizeof(uint32_t)));
+	for (uint_fast16_t i = 0; i < compiler->current_global; i++)
+		writers[i] = UINT32_MAX;
+
+	//the instruction that writes each global, or UINT32_MAX - 1 once it's written by more than one
+	for (uint_fast32_t ip = 0; ip < compiler->ins_builder.instruction_count; ip++) {
+		uint8_t roles[3];
+		ins_operand_roles(instructions[ip], roles);
+		for (uint_fast8_t i = 0; i < 3; i++)
+			if ((roles[i] & OPERAND_WRITE) && !instructions[ip].regs[i].offset && instructions[ip].regs[i].reg >= constant_count && instructions[ip].regs[i].reg < FOLDED_CONSTANT_BASE)
+				writers[instructions[ip].regs[i].reg - constant_count] = writers[instructions[ip].regs[i].reg - constant_count] == UINT32_MAX ? ip : UINT32_MAX - 1;
+	}
+
+	int changed = 0;
+	for (uint_fast32_t ip = 0; ip < compiler->ins_builder.instruction_count; ip++) {
+		uint8_t roles[3];
+		ins_operand_roles(instructions[ip], roles);
+		for (uint_fast8_t i = 0; i < 3; i++) {
+			compiler_reg_t reg = instructions[ip].regs[i];
+			if (roles[i] != OPERAND_READ || reg.offset || reg.reg < constant_count || reg.reg >= FOLDED_CONSTANT_BASE)
+				continue;
+			uint32_t writer = writers[reg.reg - constant_count];
+			if (writer < UINT32_MAX - 1 && instructions[writer].op_code == COMPILER_OP_CODE_MOVE && IS_CONSTANT(instructions[writer].regs[1])) {
+				instructions[ip].regs[i] = instructions[writer].regs[1];
+				changed = 1;
+			}
+		}
+	}
+
+	safe_free(compiler->safe_gc, writers);
+	return changed;
+}
+
+int fold_constants(compiler_t* compiler) {
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint32_t count = compiler->ins_builder.instruction_count;
+
+	constant_folder_t folder;
+	folder.compiler = compiler;
+	folder.folded_count = 0;
+	ESCAPE_ON_FAIL(folder.folded = safe_malloc(compiler->safe_gc, (folder.alloced_folded = 16) * sizeof(machine_reg_t)));
+
+	//nothing is known at the start of a block
+	uint8_t* leaders;
+	ESCAPE_ON_FAIL(leaders = safe_calloc(compiler->safe_gc, count + 1, sizeof(uint8_t)));
+	leaders[0] = 1;
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		switch (instructions[ip].op_code) {
+		case COMPILER_OP_CODE_JUMP:
+			leaders[instructions[ip].regs[0].reg] = 1;
+			leaders[ip + 1] = 1;
+			break;
+		case COMPILER_OP_CODE_JUMP_CHECK:
+		case COMPILER_OP_CODE_LABEL:
+			leaders[instructions[ip].regs[1].reg] = 1;
+			leaders[ip + 1] = 1;
+			break;
+		case COMPILER_OP_CODE_CALL:
+		case COMPILER_OP_CODE_RETURN:
+		case COMPILER_OP_CODE_TAIL_CALL:
+		case COMPILER_OP_CODE_ABORT:
+			leaders[ip + 1] = 1;
+			break;
+		}
+
+	//folding a global's value may let other globals be folded, and so on
+	int changed;
+	do {
+		changed = fold_blocks(&folder, leaders);
+		changed |= fold_globals(&folder);
+	} while (changed);
+
+	//folded constants go after the existing ones, which moves every global up
+	if (folder.folded_count) {
+		uint16_t constant_count = compiler->ast->constant_count;
+		machine_reg_t* stack;
+		ESCAPE_ON_FAIL(stack = realloc(compiler->target_machine->stack, (constant_count + folder.folded_count) * sizeof(machine_reg_t)));
+		compiler->target_machine->stack = stack;
+		for (uint_fast32_t i = 0; i < folder.folded_count; i++)
+			stack[constant_count + i] = folder.folded[i];
+
+		for (uint_fast32_t ip = 0; ip < count; ip++) {
+			uint8_t roles[3];
+			ins_operand_roles(instructions[ip], roles);
+			for (uint_fast8_t i = 0; i < 3; i++)
+				if (roles[i] != OPERAND_IMMEDIATE && !instructions[ip].regs[i].offset) {
+					if (instructions[ip].regs[i].reg >= FOLDED_CONSTANT_BASE)
+						instructions[ip].regs[i].reg = constant_count + instructions[ip].regs[i].reg - FOLDED_CONSTANT_BASE;
+					else if (instructions[ip].regs[i].reg >= constant_count)
+						instructions[ip].regs[i].reg += folder.folded_count;
+				}
+		}
+
+		//the program's first instruction reserves the global registers
+		if (instructions[0].op_code == COMPILER_OP_CODE_STACK_OFFSET)
+			instructions[0].regs[0].reg += folder.folded_count;
+		compiler->ast->constant_count += folder.folded_count;
+	}
+
+	safe_free(compiler->safe_gc, leaders);
+	safe_free(compiler->safe_gc, folder.folded);
+	return 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef FOLD_H
+#define FOLD_H
+
+#include <stdint.h>
+#include "compiler.h"
+
+#define MAX_FOLD_FACTS 32
+
+//constants made while folding are numbered from here, until they're appended to the constant table
+#define FOLDED_CONSTANT_BASE 0x80000000
+
+typedef struct fold_fact {
+	compiler_reg_t reg, constant; //reg holds the same value as constant
+} fold_fact_t;
+
+typedef struct constant_folder {
+	compiler_t* compiler;
+
+	machine_reg_t* folded;
+	uint32_t folded_count, alloced_folded;
+
+	fold_fact_t facts[MAX_FOLD_FACTS];
+	uint8_t fact_count;
+} constant_folder_t;
+
+int fold_constants(compiler_t* compiler);
+
+#endif // !FOLD_H
@@ -2,7 +2,7 @@
 
 #define LABEL_IP(IP) label_buf->ins_label[IP] = ++label_buf->total_labels;
 int init_label_buf(label_buf_t* label_buf, safe_gc_t* safe_gc, compiler_ins_t* compiler_ins, uint64_t instruction_count, dbg_table_t* dbg_table) {
-	ESCAPE_ON_FAIL(label_buf->ins_label = safe_calloc(safe_gc, instruction_count, sizeof(uint16_t)));
+	ESCAPE_ON_FAIL(label_buf->ins_label = safe_calloc(safe_gc, instruction_count, sizeof(uint32_t)));
 	ESCAPE_ON_FAIL(label_buf->get_dbg_src_loc = safe_calloc(safe_gc, dbg_table->src_loc_count, sizeof(int)));
 	label_buf->total_labels = 0;
 
@@ -18,8 +18,17 @@ int init_label_buf(label_buf_t* label_buf, safe_gc_t* safe_gc, compiler_ins_t* c
 		case COMPILER_OP_CODE_LOAD_ALLOC_I:
 		case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
 		case COMPILER_OP_CODE_STORE_ALLOC:
+		case COMPILER_OP_CODE_STORE_ALLOC_I:
 		case COMPILER_OP_CODE_STORE_ALLOC_I_BOUND:
+		case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+		case COMPILER_OP_CODE_STORE_ALLOC_INBOUND:
+		case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
 		case COMPILER_OP_CODE_FREE:
+		case COMPILER_OP_CODE_RC_RELEASE:
+		case COMPILER_OP_CODE_ALLOC:
+		case COMPILER_OP_CODE_ALLOC_I:
+		case COMPILER_OP_CODE_ALLOC_I_INIT:
+		case COMPILER_OP_CODE_FOREIGN:
 		case COMPILER_OP_CODE_STACK_VALIDATE:
 		case COMPILER_OP_CODE_GC_NEW_FRAME:
 		case COMPILER_OP_CODE_LONG_DIVIDE:
@@ -44,6 +53,21 @@ int init_label_buf(label_buf_t* label_buf, safe_gc_t* safe_gc, compiler_ins_t* c
 		case COMPILER_OP_CODE_JUMP_CHECK:
 			LABEL_IP(compiler_ins[i].regs[1].reg);
 			break;
+		case COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_BOOL_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_CHAR_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_LONG_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE:
+		case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS:
+		case COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_LONG_LESS_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE:
+		case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS:
+		case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE_EQUAL:
+		case COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS_EQUAL:
+			LABEL_IP(compiler_ins[i].regs[2].reg);
+			break;
 		case COMPILER_OP_CODE_CALL:
 			label_buf->get_dbg_src_loc[src_loc_id] = 1;
 			LABEL_IP(i + 1);
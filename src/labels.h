@@ -8,9 +8,9 @@
 #include "debug.h"
 
 typedef struct label_buf {
-	uint16_t total_labels;
+	uint32_t total_labels;
 
-	uint16_t* ins_label;
+	uint32_t* ins_label;
 	int* get_dbg_src_loc;
 } label_buf_t;
 
@@ -0,0 +1,76 @@
+#include "locals.h"
+
+#define FOR_PROC_INS(PROC, IP) for (uint32_t IP = compiler->proc_label_ips[PROC] + 2, proc_end = instructions[compiler->proc_label_ips[PROC] + 1].regs[0].reg; IP < proc_end; IP = next_proc_ip(instructions, IP))
+
+int lower_locals(local_lowering_t* lowering, compiler_t* compiler) {
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint16_t proc_count = compiler->proc_count;
+
+	lowering->lowered = compiler->proc_local_kinds;
+	lowering->local_counts = compiler->proc_call_max_locals;
+	lowering->proc_count = proc_count;
+
+	uint8_t* reaches;
+	uint8_t* reaches_unknown;
+	ESCAPE_ON_FAIL(reaches = safe_calloc(compiler->safe_gc, proc_count * proc_count, sizeof(uint8_t)));
+	ESCAPE_ON_FAIL(reaches_unknown = safe_calloc(compiler->safe_gc, proc_count, sizeof(uint8_t)));
+
+	//find each proc's callees, and the registers whose addresses are handed to foreign functions
+	for (uint_fast16_t proc = 0; proc < proc_count; proc++) {
+		if (compiler->proc_label_ips[proc] == UINT32_MAX)
+			continue;
+		FOR_PROC_INS(proc, ip) {
+			switch (instructions[ip].op_code) {
+			case COMPILER_OP_CODE_CALL:
+			case COMPILER_OP_CODE_TAIL_CALL: {
+				uint16_t callee = find_callee(compiler, instructions[ip].regs[0]);
+				if (callee == UINT16_MAX)
+					reaches_unknown[proc] = 1;
+				else
+					reaches[proc * proc_count + callee] = 1;
+				break;
+			}
+			case COMPILER_OP_CODE_FOREIGN:
+				for (uint_fast8_t i = 0; i < 3; i++)
+					if (instructions[ip].regs[i].offset && instructions[ip].regs[i].reg <= compiler->proc_call_max_locals[proc])
+						compiler->proc_local_kinds[proc][instructions[ip].regs[i].reg] |= LOCAL_KIND_UNLOWERABLE;
+				break;
+			}
+		}
+	}
+
+	//every proc reachable through calls, and whether an unknown proc may be called along the way
+	for (uint_fast16_t via = 0; via < proc_count; via++)
+		for (uint_fast16_t from = 0; from < proc_count; from++)
+			if (reaches[from * proc_count + via]) {
+				for (uint_fast16_t to = 0; to < proc_count; to++)
+					reaches[from * proc_count + to] |= reaches[via * proc_count + to];
+				reaches_unknown[from] |= reaches_unknown[via];
+			}
+
+	for (uint_fast16_t proc = 0; proc < proc_count; proc++) {
+		if (compiler->proc_label_ips[proc] == UINT32_MAX)
+			continue;
+
+		//only registers that hold primitives, and never escape the proc's frame, are lowered
+		for (uint_fast16_t i = 0; i <= compiler->proc_call_max_locals[proc]; i++)
+			compiler->proc_local_kinds[proc][i] = (compiler->proc_local_kinds[proc][i] == LOCAL_KIND_PRIMITIVE);
+
+		FOR_PROC_INS(proc, ip) {
+			for (uint_fast8_t i = 0; i < 3; i++)
+				if (instructions[ip].regs[i].offset && instructions[ip].regs[i].reg <= compiler->proc_call_max_locals[proc] && compiler->proc_local_kinds[proc][instructions[ip].regs[i].reg])
+					instructions[ip].regs[i] = (compiler_reg_t){ .reg = ((uint32_t)proc << 16) | instructions[ip].regs[i].reg, .offset = C_LOCAL_OFFSET };
+
+			//a call that may re-enter the proc spills its c locals to their stack registers, and reloads them once it returns
+			if (instructions[ip].op_code == COMPILER_OP_CODE_CALL) {
+				uint16_t callee = find_callee(compiler, instructions[ip].regs[0]);
+				if (callee == UINT16_MAX || callee == proc || reaches[callee * proc_count + proc] || reaches_unknown[callee])
+					instructions[ip].regs[2] = (compiler_reg_t){ .reg = proc, .offset = 1 };
+			}
+		}
+	}
+
+	safe_free(compiler->safe_gc, reaches);
+	safe_free(compiler->safe_gc, reaches_unknown);
+	return 1;
+}
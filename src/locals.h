@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef LOCALS_H
+#define LOCALS_H
+
+#include <stdint.h>
+#include "compiler.h"
+
+//lowered local registers are tagged with this offset, and numbered (proc id << 16) | register
+#define C_LOCAL_OFFSET 2
+
+typedef struct local_lowering {
+	uint8_t** lowered; //per proc, whether each local register is emitted as a c local rather than a stack register
+	uint16_t* local_counts;
+	uint16_t proc_count;
+} local_lowering_t;
+
+int lower_locals(local_lowering_t* lowering, compiler_t* compiler);
+
+#endif // !LOCALS_H
@@ -37,7 +37,7 @@ typedef struct machine {
 	uint16_t defined_sig_count, alloced_sig_defs;
 } machine_t;
 
-int init_machine(machine_t* machine, uint16_t stack_size, uint16_t frame_limit, uint16_t type_count);
+int init_machine(machine_t* machine, uint16_t stack_size, uint16_t type_count);
 void free_machine(machine_t* machine);
 
 machine_type_sig_t* machine_get_typesig(machine_t* machine, machine_type_sig_t* t, int optimize_common);
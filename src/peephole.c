@@ -0,0 +1,269 @@
+#include <string.h>
+#include "locals.h"
+#include "peephole.h"
+
+#define REG_EQ(A, B) ((A).reg == (B).reg && (A).offset == (B).offset)
+
+#define LIVE_ADD(SET, INDEX) { int index = (INDEX); if (index >= 0) (SET).words[index / 64] |= UINT64_C(1) << (index % 64); }
+#define LIVE_REMOVE(SET, INDEX) { int index = (INDEX); if (index >= 0) (SET).words[index / 64] &= ~(UINT64_C(1) << (index % 64)); }
+
+//gets a register's index in live sets, or -1 if its liveness isn't tracked
+static int live_index(compiler_reg_t reg) {
+	if (reg.offset == C_LOCAL_OFFSET)
+		return (reg.reg & UINT16_MAX) < MAX_LIVE_REGS ? (int)(MAX_LIVE_REGS + (reg.reg & UINT16_MAX)) : -1;
+	else if (reg.offset)
+		return reg.reg < MAX_LIVE_REGS ? (int)reg.reg : -1;
+	return -1; //globals can be read by any proc
+}
+
+static int is_live(live_set_t live, compiler_reg_t reg) {
+	int index = live_index(reg);
+	return index < 0 || ((live.words[index / 64] >> (index % 64)) & 1);
+}
+
+//gets the instructions control may go to after an instruction, and returns how many there are
+static int successors(peephole_t* peephole, uint32_t ip, uint32_t* succs) {
+	compiler_ins_t ins = peephole->compiler->ins_builder.instructions[ip];
+	int count = 0;
+	switch (ins.op_code) {
+	case COMPILER_OP_CODE_JUMP:
+		succs[count++] = ins.regs[0].reg;
+		break;
+	case COMPILER_OP_CODE_JUMP_CHECK:
+		succs[count++] = ip + 1;
+		succs[count++] = ins.regs[1].reg;
+		break;
+	case COMPILER_OP_CODE_RETURN:
+	case COMPILER_OP_CODE_TAIL_CALL:
+	case COMPILER_OP_CODE_ABORT:
+		break;
+	default:
+		succs[count++] = ip + 1; //calls return to the instruction after them
+		break;
+	}
+	return count;
+}
+
+static live_set_t live_out(peephole_t* peephole, uint32_t ip) {
+	live_set_t live = { 0 };
+	uint32_t succs[2];
+	int succ_count = successors(peephole, ip, succs);
+	for (int i = 0; i < succ_count; i++)
+		if (succs[i] < peephole->compiler->ins_builder.instruction_count)
+			for (uint_fast8_t j = 0; j < LIVE_SET_WORDS; j++)
+				live.words[j] |= peephole->live_in[succs[i]].words[j];
+	return live;
+}
+
+//gets the registers live going into an instruction, from those live coming out of it
+static live_set_t live_transfer(compiler_ins_t ins, live_set_t live) {
+	uint8_t roles[3];
+	ins_operand_roles(ins, roles);
+
+	//instructions read all their operands before writing any of them
+	for (uint_fast8_t i = 0; i < 3; i++)
+		if (roles[i] == OPERAND_WRITE)
+			LIVE_REMOVE(live, live_index(ins.regs[i]));
+
+	switch (ins.op_code) {
+	case COMPILER_OP_CODE_CALL: //the callee returns its value at the start of its frame, and may read anything after that
+		LIVE_REMOVE(live, live_index((compiler_reg_t) { .reg = ins.regs[1].reg, .offset = 1 }));
+		//fall through
+	case COMPILER_OP_CODE_TAIL_CALL:
+		for (uint_fast32_t i = ins.regs[1].reg + 1; i < MAX_LIVE_REGS; i++)
+			LIVE_ADD(live, i);
+		break;
+	case COMPILER_OP_CODE_RETURN:
+		LIVE_ADD(live, live_index((compiler_reg_t) { .reg = 0, .offset = 1 }));
+		break;
+	default:
+		break;
+	}
+
+	for (uint_fast8_t i = 0; i < 3; i++)
+		if (roles[i] & OPERAND_READ)
+			LIVE_ADD(live, live_index(ins.regs[i]));
+	return live;
+}
+
+static void compute_liveness(peephole_t* peephole) {
+	compiler_ins_t* instructions = peephole->compiler->ins_builder.instructions;
+	uint32_t count = peephole->compiler->ins_builder.instruction_count;
+
+	//loops carry liveness back to their headers, which takes another sweep for each level of nesting
+	int changed;
+	do {
+		changed = 0;
+		for (uint32_t ip = count; ip-- > 0;) {
+			live_set_t live = live_transfer(instructions[ip], live_out(peephole, ip));
+			if (memcmp(&live, &peephole->live_in[ip], sizeof(live_set_t))) {
+				peephole->live_in[ip] = live;
+				changed = 1;
+			}
+		}
+	} while (changed);
+}
+
+//gets which operand an instruction writes its result to, if writing it is all the instruction does, otherwise -1
+static int result_operand(compiler_ins_t ins) {
+	switch (ins.op_code) {
+	case COMPILER_OP_CODE_MOVE:
+	case COMPILER_OP_CODE_NOT:
+	case COMPILER_OP_CODE_LENGTH:
+	case COMPILER_OP_CODE_LONG_NEGATE:
+	case COMPILER_OP_CODE_FLOAT_NEGATE:
+		return 0;
+	case COMPILER_OP_CODE_LOAD_ALLOC_I:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_BOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_I_INIT:
+		return 1;
+	case COMPILER_OP_CODE_LOAD_ALLOC:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INIT:
+	case COMPILER_OP_CODE_LOAD_ALLOC_INBOUND_INIT:
+	case COMPILER_OP_CODE_AND:
+	case COMPILER_OP_CODE_OR:
+	case COMPILER_OP_CODE_LONG_DIVIDE_NONZERO:
+		return 2;
+	default:
+		if (ins.op_code >= COMPILER_OP_CODE_PTR_EQUAL && ins.op_code <= COMPILER_OP_CODE_FLOAT_EXPONENTIATE)
+			return 2;
+		return -1;
+	}
+}
+
+//gets the compare-and-jump a comparison fuses into, or the jump check itself if it doesn't
+static compiler_op_code_t fused_jump_check(compiler_op_code_t comparison) {
+	if (comparison >= COMPILER_OP_CODE_PTR_EQUAL && comparison <= COMPILER_OP_CODE_FLOAT_EQUAL)
+		return COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL + (comparison - COMPILER_OP_CODE_PTR_EQUAL);
+	else if (comparison >= COMPILER_OP_CODE_LONG_MORE && comparison <= COMPILER_OP_CODE_LONG_LESS_EQUAL)
+		return COMPILER_OP_CODE_JUMP_CHECK_LONG_MORE + (comparison - COMPILER_OP_CODE_LONG_MORE);
+	else if (comparison >= COMPILER_OP_CODE_FLOAT_MORE && comparison <= COMPILER_OP_CODE_FLOAT_LESS_EQUAL)
+		return COMPILER_OP_CODE_JUMP_CHECK_FLOAT_MORE + (comparison - COMPILER_OP_CODE_FLOAT_MORE);
+	return COMPILER_OP_CODE_JUMP_CHECK;
+}
+
+//gets the instruction that always runs right before another, skipping removed instructions, or UINT32_MAX if the other instruction can be jumped to
+static uint32_t only_predecessor(peephole_t* peephole, uint32_t ip) {
+	while (ip && !peephole->leaders[ip]) {
+		ip--;
+		if (peephole->compiler->ins_builder.instructions[ip].op_code != COMPILER_OP_CODE_NOP)
+			return ip;
+	}
+	return UINT32_MAX;
+}
+
+//follows a jump's target past removed instructions and through unconditional jumps, without leaving the jump's proc
+static uint32_t thread_target(peephole_t* peephole, uint32_t ip, uint32_t target) {
+	compiler_ins_t* instructions = peephole->compiler->ins_builder.instructions;
+	uint32_t count = peephole->compiler->ins_builder.instruction_count;
+
+	for (uint_fast32_t hops = 0; target < count && hops < count; hops++) {
+		uint32_t next;
+		if (instructions[target].op_code == COMPILER_OP_CODE_NOP)
+			next = target + 1;
+		else if (instructions[target].op_code == COMPILER_OP_CODE_JUMP && !(target && instructions[target - 1].op_code == COMPILER_OP_CODE_LABEL)) //the jump over a proc's body marks where the body ends
+			next = instructions[target].regs[0].reg;
+		else
+			break;
+		if (next >= count || peephole->owners[next] != peephole->owners[ip])
+			break;
+		target = next;
+	}
+	return target;
+}
+
+//forwards results past moves out of dead temporaries, and fuses comparisons into the jump checks reading them
+static void coalesce(peephole_t* peephole) {
+	compiler_ins_t* instructions = peephole->compiler->ins_builder.instructions;
+
+	for (uint_fast32_t ip = 0; ip < peephole->compiler->ins_builder.instruction_count; ip++) {
+		compiler_ins_t* ins = &instructions[ip];
+		uint32_t prev = only_predecessor(peephole, ip);
+		int result;
+
+		if (ins->op_code == COMPILER_OP_CODE_MOVE) {
+			if (REG_EQ(ins->regs[0], ins->regs[1]))
+				*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_NOP };
+			else if (prev != UINT32_MAX && (result = result_operand(instructions[prev])) >= 0 && REG_EQ(instructions[prev].regs[result], ins->regs[1]) && !is_live(live_out(peephole, ip), ins->regs[1])) {
+				instructions[prev].regs[result] = ins->regs[0];
+				*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_NOP };
+			}
+		}
+		else if (ins->op_code == COMPILER_OP_CODE_JUMP_CHECK && prev != UINT32_MAX) {
+			compiler_op_code_t fused = fused_jump_check(instructions[prev].op_code);
+			if (fused != COMPILER_OP_CODE_JUMP_CHECK && REG_EQ(instructions[prev].regs[2], ins->regs[0]) && !is_live(live_out(peephole, ip), ins->regs[0])) {
+				*ins = (compiler_ins_t){ .op_code = fused, .regs = { instructions[prev].regs[0], instructions[prev].regs[1], ins->regs[1] } };
+				instructions[prev] = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_NOP };
+			}
+		}
+	}
+}
+
+//retargets jumps that land on other jumps, and removes jumps to where control would go anyway
+static void thread_jumps(peephole_t* peephole) {
+	compiler_ins_t* instructions = peephole->compiler->ins_builder.instructions;
+
+	for (uint_fast32_t ip = 0; ip < peephole->compiler->ins_builder.instruction_count; ip++) {
+		compiler_ins_t* ins = &instructions[ip];
+		int target_operand;
+		if (ins->op_code == COMPILER_OP_CODE_JUMP && !(ip && instructions[ip - 1].op_code == COMPILER_OP_CODE_LABEL))
+			target_operand = 0;
+		else if (ins->op_code == COMPILER_OP_CODE_JUMP_CHECK)
+			target_operand = 1;
+		else if (ins->op_code >= COMPILER_OP_CODE_JUMP_CHECK_PTR_EQUAL && ins->op_code <= COMPILER_OP_CODE_JUMP_CHECK_FLOAT_LESS_EQUAL)
+			target_operand = 2;
+		else
+			continue;
+
+		ins->regs[target_operand].reg = thread_target(peephole, ip, ins->regs[target_operand].reg);
+		if (ins->regs[target_operand].reg == thread_target(peephole, ip, ip + 1))
+			*ins = (compiler_ins_t){ .op_code = COMPILER_OP_CODE_NOP }; //comparisons don't have side effects, so checks that go the same way either way can go too
+	}
+}
+
+int peephole_optimize(compiler_t* compiler) {
+	compiler_ins_t* instructions = compiler->ins_builder.instructions;
+	uint32_t count = compiler->ins_builder.instruction_count;
+
+	peephole_t peephole;
+	peephole.compiler = compiler;
+	ESCAPE_ON_FAIL(peephole.leaders = safe_calloc(compiler->safe_gc, count + 1, sizeof(uint8_t)));
+	ESCAPE_ON_FAIL(peephole.owners = safe_malloc(compiler->safe_gc, (count + 1) * sizeof(uint32_t)));
+	ESCAPE_ON_FAIL(peephole.live_in = safe_calloc(compiler->safe_gc, count + 1, sizeof(live_set_t)));
+
+	//instructions control can jump to, rather than only fall through to
+	peephole.leaders[0] = 1;
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		switch (instructions[ip].op_code) {
+		case COMPILER_OP_CODE_JUMP:
+			peephole.leaders[instructions[ip].regs[0].reg] = 1;
+			break;
+		case COMPILER_OP_CODE_JUMP_CHECK:
+		case COMPILER_OP_CODE_LABEL:
+			peephole.leaders[instructions[ip].regs[1].reg] = 1;
+			break;
+		case COMPILER_OP_CODE_CALL:
+			peephole.leaders[ip + 1] = 1;
+			break;
+		default:
+			break;
+		}
+
+	//nested procs come after the procs they're nested in, so the innermost one is marked last
+	for (uint_fast32_t ip = 0; ip <= count; ip++)
+		peephole.owners[ip] = UINT32_MAX;
+	for (uint_fast32_t ip = 0; ip < count; ip++)
+		if (instructions[ip].op_code == COMPILER_OP_CODE_LABEL)
+			for (uint_fast32_t body_ip = ip + 2; body_ip < instructions[ip + 1].regs[0].reg; body_ip++)
+				peephole.owners[body_ip] = ip;
+
+	compute_liveness(&peephole);
+	coalesce(&peephole);
+	thread_jumps(&peephole);
+
+	safe_free(compiler->safe_gc, peephole.leaders);
+	safe_free(compiler->safe_gc, peephole.owners);
+	safe_free(compiler->safe_gc, peephole.live_in);
+	return 1;
+}
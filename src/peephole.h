@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdint.h>
+#include "compiler.h"
+
+//locals, and c locals, numbered past this are assumed to always be live
+#define MAX_LIVE_REGS 128
+#define LIVE_SET_WORDS (2 * MAX_LIVE_REGS / 64)
+
+typedef struct live_set {
+	uint64_t words[LIVE_SET_WORDS];
+} live_set_t;
+
+typedef struct peephole {
+	compiler_t* compiler;
+
+	uint8_t* leaders;
+	uint32_t* owners; //the label instruction of the innermost proc each instruction is in, or UINT32_MAX for top level instructions
+	live_set_t* live_in; //registers that may be read before they're written, going into each instruction
+} peephole_t;
+
+int peephole_optimize(compiler_t* compiler);
+
+#endif // !PEEPHOLE_H
@@ -149,6 +149,10 @@ static int ast_postproc_value_affects_state(int affects_state, ast_value_t* valu
 		CHECK_AFFECTS_STATE(affects_state, &value->data.alloc_array->size);
 		break;
 	case AST_VALUE_ALLOC_RECORD:
+		if (affects_state && !value->data.alloc_record.proto->is_used) {
+			value->data.alloc_record.proto->is_used = 1;
+			changes_made = 1;
+		}
 		for (uint_fast16_t i = 0; i < value->data.alloc_record.init_value_count; i++)
 			CHECK_AFFECTS_STATE(affects_state, &value->data.alloc_record.init_values[i].value);
 		break;
@@ -243,7 +247,7 @@ static int ast_postproc_codeblock_affects_state(ast_code_block_t* code_block, in
 			CHECK_AFFECTS_STATE(ast_postproc_value_affects_state(current_statement->data.var_decl.var_info->is_used, &current_statement->data.var_decl.set_value, second_pass));
 			break;
 		case AST_STATEMENT_RECORD_PROTO: {
-			if (!second_pass) {
+			if (!second_pass && current_statement->data.record_proto->is_used) { //a record's defaults are only evaluated when it's allocated
 				for (uint_fast16_t i = 0; i < current_statement->data.record_proto->default_value_count; i++)
 					CHECK_AFFECTS_STATE(ast_postproc_value_affects_state(1, &current_statement->data.record_proto->default_values[i].value, 0));
 			}
@@ -810,6 +814,11 @@ int ast_postproc(ast_parser_t* ast_parser) {
 
 	while (ast_postproc_codeblock_affects_state(&ast_parser->ast->exec_block, 1)) {}
 
+	//a used record's supertypes are checked against at runtime, so the records it extends are used too
+	for (uint_fast8_t i = 0; i < ast_parser->ast->record_count; i++)
+		for (ast_record_proto_t* record = ast_parser->ast->record_protos[i]; record->is_used && record->base_record; record = ast_parser->ast->record_protos[record->base_record->type_id])
+			ast_parser->ast->record_protos[record->base_record->type_id]->is_used = 1;
+
 	safe_free(ast_parser->safe_gc, shared_top_level);
 	safe_free(ast_parser->safe_gc, top_level_locals);
 	safe_free(ast_parser->safe_gc, ast_parser->shared_globals);
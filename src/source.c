@@ -9,6 +9,9 @@
 #include "machine.h"
 #include "debug.h"
 #include "labels.h"
+#include "checks.h"
+#include "fold.h"
+#include "peephole.h"
 #include "emit.h"
 
 #define ABORT(MSG) {printf MSG ; putchar('\n'); exit(EXIT_FAILURE);}
@@ -17,6 +20,7 @@
 #define EXPECT_FLAG(FLAG) if(current_arg == argc || strcmp(READ_ARG, FLAG)) { ABORT(("Unexpected flag %s.\n", FLAG)); }
 
 #define HAS_EXT_FLAG(FLAG) has_flag(FLAG, argv, extra_flags, argc)
+#define EXT_FLAG_ARG(FLAG) get_flag_arg(FLAG, argv, extra_flags, argc)
 
 int has_flag(const char* flag, const char** argv, int extra_flag_start, int argc) {
 	for (int i = extra_flag_start; i < argc; i++)
@@ -25,6 +29,13 @@ int has_flag(const char* flag, const char** argv, int extra_flag_start, int argc
 	return 0;
 }
 
+const char* get_flag_arg(const char* flag, const char** argv, int extra_flag_start, int argc) {
+	for (int i = extra_flag_start; i < argc - 1; i++)
+		if (!strcmp(argv[i], flag))
+			return argv[i + 1];
+	return NULL;
+}
+
 int main(int argc, const char** argv) {
 	int current_arg = 0;
 	const char* working_dir = READ_ARG;
@@ -58,17 +69,9 @@ int main(int argc, const char** argv) {
 		ABORT(("Syntax error(%s).\n", get_err_msg(parser.last_err)));
 	}
 
-	compiler_t compiler;
-	machine_t machine;
-	if (!compile(&compiler, &safe_gc, &machine, &ast)) {
-		free_safe_gc(&safe_gc, 1);
-		ABORT(("IL Compilation failiure(%s).\n", get_err_msg(compiler.last_err)));
-	}
-
 	EXPECT_FLAG("-o");
 	const char* output_path = READ_ARG;
 	if (!strcmp(get_filepath_ext(output_path), "txt") || !strcmp(get_filepath_ext(output_path), "sf") || !strcmp(get_filepath_ext(output_path), "csh")) {
-		free_machine(&machine);
 		free_safe_gc(&safe_gc, 1);
 		ABORT(("Stopped compilation: Potentially unwanted source file override.\n"
 			"Are you sure you want to override %s?", output_path));
@@ -76,6 +79,55 @@ int main(int argc, const char** argv) {
 
 	int extra_flags = current_arg;
 
+	//generic procs may be cloned for each tuple of concrete type arguments they're called with, up to a limit of clones per proc
+	uint16_t mono_limit = 0;
+	if (EXT_FLAG_ARG("-mono-limit")) {
+		unsigned long limit = strtoul(EXT_FLAG_ARG("-mono-limit"), NULL, 10);
+		if (limit >= UINT16_MAX) {
+			free_safe_gc(&safe_gc, 1);
+			ABORT(("Invalid monomorphization limit %s, expected a limit below %i.", EXT_FLAG_ARG("-mono-limit"), UINT16_MAX));
+		}
+		mono_limit = (uint16_t)limit;
+	}
+	else if (HAS_EXT_FLAG("-monomorphize"))
+		mono_limit = 16;
+
+	//calls to small procs may have the callee's body spliced in, up to a limit on how many values and statements it has
+	uint16_t inline_limit = 0;
+	if (EXT_FLAG_ARG("-inline-limit")) {
+		unsigned long limit = strtoul(EXT_FLAG_ARG("-inline-limit"), NULL, 10);
+		if (limit >= UINT16_MAX) {
+			free_safe_gc(&safe_gc, 1);
+			ABORT(("Invalid inlining limit %s, expected a limit below %i.", EXT_FLAG_ARG("-inline-limit"), UINT16_MAX));
+		}
+		inline_limit = (uint16_t)limit;
+	}
+	else if (HAS_EXT_FLAG("-inline"))
+		inline_limit = 24;
+
+	//loop invariant values are evaluated once before their loop, and products of induction variables are stepped along with them
+	int optimize_loops = HAS_EXT_FLAG("-optimize-loops");
+
+	//a variable's register is reused by later variables, temporaries and call frames once it's no longer live, which narrows frames
+	int compact_frames = HAS_EXT_FLAG("-compact-frames");
+
+	//reference counting also releases the references locals hold once they're overwritten or go out of scope
+	int rc_mode = HAS_EXT_FLAG("-rc");
+
+	compiler_t compiler;
+	machine_t machine;
+	if (!compile(&compiler, &safe_gc, &machine, &ast, mono_limit, inline_limit, optimize_loops, compact_frames, rc_mode)) {
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("IL Compilation failiure(%s).\n", get_err_msg(compiler.last_err)));
+	}
+
+	//expressions over constants, and globals only ever set to a constant, are evaluated at compile time
+	if (HAS_EXT_FLAG("-fold-constants") && !fold_constants(&compiler)) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Failed to fold constants."));
+	}
+
 	FILE* output_file = fopen(output_path, "wb");
 	if (!output_file) {
 		free_machine(&machine);
@@ -84,7 +136,98 @@ int main(int argc, const char** argv) {
 	}
 
 	int robo_mode = HAS_EXT_FLAG("-vex") || HAS_EXT_FLAG("-robo");
-	int debug = HAS_EXT_FLAG("-dbg");
+	int heap_profile = HAS_EXT_FLAG("-heapprof");
+	int debug = HAS_EXT_FLAG("-dbg") || heap_profile; //the heap profiler reports allocation sites using debug source locations
+
+	//how many candidates reference counting buffers before it collects them
+	uint32_t rc_threshold = 0;
+	if (EXT_FLAG_ARG("-rc-threshold") && !(rc_threshold = strtoul(EXT_FLAG_ARG("-rc-threshold"), NULL, 10))) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Invalid reference counting threshold %s, expected a positive number of candidates.", EXT_FLAG_ARG("-rc-threshold")));
+	}
+	int stats = HAS_EXT_FLAG("-stats");
+
+	//incremental sweeping spreads a clean's sweep over safepoints, with a per-step budget in objects or microseconds
+	uint32_t gc_step_budget = 0;
+	int gc_step_micros = 0;
+	if (EXT_FLAG_ARG("-gc-step-us")) {
+		gc_step_budget = strtoul(EXT_FLAG_ARG("-gc-step-us"), NULL, 10);
+		gc_step_micros = 1;
+	}
+	else if (EXT_FLAG_ARG("-gc-step"))
+		gc_step_budget = strtoul(EXT_FLAG_ARG("-gc-step"), NULL, 10);
+	else if (HAS_EXT_FLAG("-incremental-gc"))
+		gc_step_budget = 256;
+
+	//the register stack's size and the call frame limit, which become initial sizes when the stack is growable
+	uint32_t stack_size = 0;
+	uint16_t frame_limit = 0;
+	int growable_stack = HAS_EXT_FLAG("-grow-stack");
+	if (EXT_FLAG_ARG("-stack-size") && (stack_size = strtoul(EXT_FLAG_ARG("-stack-size"), NULL, 10)) <= (uint32_t)ast.constant_count + compiler.current_global) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Invalid stack size %s, the program's constants and globals take %"PRIu32" registers.", EXT_FLAG_ARG("-stack-size"), (uint32_t)ast.constant_count + compiler.current_global));
+	}
+
+	//large programs, such as heavily inlined and folded ones, may have more constants and globals than the runtime's default stack of UINT16_MAX / 8 registers has room for
+	if (!stack_size && (uint32_t)ast.constant_count + compiler.current_global >= UINT16_MAX / 16)
+		stack_size = (uint32_t)ast.constant_count + compiler.current_global + UINT16_MAX / 8;
+	if (EXT_FLAG_ARG("-frame-limit")) {
+		unsigned long limit = strtoul(EXT_FLAG_ARG("-frame-limit"), NULL, 10);
+		if (!limit || limit >= UINT16_MAX - 1) {
+			free_machine(&machine);
+			free_safe_gc(&safe_gc, 1);
+			ABORT(("Invalid frame limit %s, expected a limit below %i.", EXT_FLAG_ARG("-frame-limit"), UINT16_MAX - 1));
+		}
+		frame_limit = (uint16_t)limit;
+	}
+
+	if (gc_step_budget && rc_mode) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Incremental gc cannot be used with reference counting."));
+	}
+
+	//capacity profiling records runtime table high-water marks, which can then be used to pre-size the tables
+	const char* capacity_profile = EXT_FLAG_ARG("-capacity-profile");
+	const char* capacity_use = EXT_FLAG_ARG("-capacity-use");
+	uint32_t capacities[RUNTIME_TABLE_COUNT];
+	if (capacity_use && !read_capacity_profile(capacities, capacity_use)) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Could not read capacity profile %s.", capacity_use));
+	}
+
+	//bounds checks on indices proven to be within their array, init checks on arrays proven to be filled, and zero checks on nonzero constant divisors, are dropped
+	if (HAS_EXT_FLAG("-elide-checks") && !elide_checks(&compiler)) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Failed to elide checks."));
+	}
+
+	//validated release builds can drop the remaining checks altogether
+	if (HAS_EXT_FLAG("-unchecked"))
+		drop_checks(&compiler);
+
+	//primitive locals that never escape their proc's frame are emitted as c locals, which gcc can keep in machine registers
+	local_lowering_t lowering;
+	int lower_locals_mode = HAS_EXT_FLAG("-lower-locals");
+	if (lower_locals_mode && !lower_locals(&lowering, &compiler)) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Failed to lower locals."));
+	}
+
+	//procs may be emitted as their own c functions rather than sharing run, so gcc optimizes and inlines each of them separately
+	int proc_functions = HAS_EXT_FLAG("-proc-functions");
+
+	//moves out of temporaries are coalesced, comparisons are fused into the jump checks that read them, and jumps are threaded
+	if (HAS_EXT_FLAG("-peephole") && !peephole_optimize(&compiler)) {
+		free_machine(&machine);
+		free_safe_gc(&safe_gc, 1);
+		ABORT(("Failed to run peephole optimizations."));
+	}
 
 	label_buf_t label_buf;
 	if (!init_label_buf(&label_buf, &safe_gc, compiler.ins_builder.instructions, compiler.ins_builder.instruction_count, &dbg_table)) {
@@ -93,7 +236,22 @@ int main(int argc, const char** argv) {
 		ABORT(("Failed to initialze label buffer."));
 	}
 
-	if (!emit_c_header(output_file, robo_mode, debug)) {
+	runtime_options_t runtime_options = {
+		.robo_mode = robo_mode,
+		.debug = debug,
+		.stats = stats,
+		.heap_profile = heap_profile,
+		.rc_mode = rc_mode,
+		.rc_threshold = rc_threshold,
+		.rc_frame_span = max_frame_span(&compiler),
+		.gc_step_budget = gc_step_budget,
+		.gc_step_micros = gc_step_micros,
+		.stack_size = stack_size,
+		.frame_limit = frame_limit,
+		.growable_stack = growable_stack,
+		.capacity_profile = capacity_profile
+	};
+	if (!emit_c_header(output_file, &runtime_options)) {
 		free_machine(&machine);
 		free_safe_gc(&safe_gc, 1);
 		ABORT(("Could not find stdheader.c. Please ensure it is in the compilers working directory."))
@@ -109,18 +267,18 @@ int main(int argc, const char** argv) {
 		}
 	}
 
-	if (!emit_init(output_file, &ast, &machine, debug)) {
+	if (!emit_init(output_file, &ast, &machine, debug, heap_profile, capacity_use ? capacities : NULL)) {
 		free_machine(&machine);
 		free_safe_gc(&safe_gc, 1);
 		ABORT(("Could not emit initialization routines."));
 	}
 
-	if (!emit_instructions(output_file, &label_buf, compiler.ins_builder.instructions, compiler.ins_builder.instruction_count, debug, &dbg_table)) {
+	if (!emit_instructions(output_file, &label_buf, compiler.ins_builder.instructions, compiler.ins_builder.instruction_count, debug, &dbg_table, lower_locals_mode ? &lowering : NULL, proc_functions ? &compiler : NULL)) {
 		free_machine(&machine);
 		free_safe_gc(&safe_gc, 1);
 		ABORT(("Failed to emit instructions. Potentially unrecognized opcode."));
 	}
-	emit_final(output_file, robo_mode, debug, source);
+	emit_final(output_file, robo_mode, debug, stats, heap_profile, source);
 
 	free_machine(&machine);
 	free_safe_gc(&safe_gc, 1);
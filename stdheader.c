@@ -28,6 +28,10 @@
 #include <math.h>
 #include <time.h>
 
+#if defined(RC_MODE) && defined(INCREMENTAL_GC)
+#error "reference counting releases the children of swept heap allocs, which incremental sweeping cannot do once they've been recycled"
+#endif
+
 #define ESCAPE_ON_FAIL(COND) {if(!(COND)) {return 0;}}
 
 typedef union machine_register machine_reg_t;
@@ -62,7 +66,9 @@ static int ffi_include_func(ffi_t* ffi_table, foreign_func func) {
 * Cish Runtime
 */
 
-#define FRAME_LIMIT 1000 //call frame limit
+#ifndef FRAME_LIMIT
+#define FRAME_LIMIT 1000 //call frame limit, or the initial number of frames when the stack is growable
+#endif // !FRAME_LIMIT
 
 #ifdef CISH_DEBUG
 
@@ -127,15 +133,37 @@ typedef enum gc_trace_mode {
 	GC_TRACE_MODE_SOME
 } gc_trace_mode_t;
 
+#ifdef RC_MODE
+typedef enum rc_color {
+	RC_BLACK, //in use, or not a collection candidate
+	RC_GRAY, //possibly garbage, its internal references are being subtracted
+	RC_WHITE, //garbage
+	RC_PURPLE, //buffered collection candidate
+	RC_FREED //freed while still buffered, recycled once it leaves the buffer
+} rc_color_t;
+#endif // RC_MODE
+
+typedef struct machine_heap_alloc heap_alloc_t;
 typedef struct machine_heap_alloc {
 	machine_reg_t* registers;
-	int* init_stat, *trace_stat;
-	uint16_t limit;
-
-	int gc_flag, reg_with_table, pre_freed;
-	gc_trace_mode_t trace_mode;
-
+	uint64_t* init_stat, *trace_stat; //bitsets of initialized and traced registers
 	machine_type_sig_t* type_sig;
+	heap_alloc_t* next_free; //links recycled allocations of the same size class
+
+	uint32_t limit;
+	uint16_t gc_frame, remembered_frame; //the gc-frame it's registered in, and the last gc-frame it was remembered in
+	uint8_t gc_flag, reg_with_table, pre_freed, trace_mode, size_class, detached;
+#ifdef INCREMENTAL_GC
+	uint32_t frame_epoch; //epoch of the gc-frame it's registered in
+#endif // INCREMENTAL_GC
+#ifdef RC_MODE
+	uint32_t ref_count; //references from the traced registers of other heap allocations
+	uint8_t rc_color, rc_buffered;
+#endif // RC_MODE
+#ifdef HEAP_PROFILE
+	uint64_t alloc_site; //source location of the instruction that allocated it
+	uint8_t site_flags;
+#endif // HEAP_PROFILE
 } heap_alloc_t;
 
 typedef union machine_register {
@@ -183,17 +211,146 @@ static const char* error_names[] = {
 	"robot error"
 };
 
-#define STACK_LIMIT (UINT16_MAX / 8)
-static machine_reg_t stack[STACK_LIMIT]; //stack memory
+#ifndef STACK_SIZE
+#define STACK_SIZE (UINT16_MAX / 8) //register stack size, or its initial size when the stack is growable
+#endif // !STACK_SIZE
+
+#ifdef GROWABLE_STACK
+/*
+* Growable stack - the register stack and the call stack are reallocated geometrically rather than overflowing.
+* Only frame pointers point into the register stack across a call; run's is reloaded whenever the stack grows, and a proc function's once its callee returns.
+*/
+
+static machine_reg_t* stack; //stack memory
+static void** positions; //call stack
+static uint32_t stack_limit;
+static uint16_t frame_limit;
+
+#define STACK_LIMIT stack_limit
+#define STACK_CHECK(SIZE, LAST_SRC_LOC) {if ((SIZE) >= stack_limit) { PANIC_ON_FAIL(grow_stack(SIZE), CISH_ERROR_STACK_OVERFLOW, LAST_SRC_LOC); fp = &stack[global_offset]; }}
+#define FRAME_CHECK(DEPTH, LAST_SRC_LOC) {if ((DEPTH) == frame_limit) PANIC_ON_FAIL(grow_frames(), CISH_ERROR_STACK_OVERFLOW, LAST_SRC_LOC);}
+#define RELOAD_FRAME_POINTER fp = &stack[global_offset]
+#else
+static machine_reg_t stack[STACK_SIZE]; //stack memory
 static void* positions[FRAME_LIMIT]; //call stack
 
+#define STACK_LIMIT STACK_SIZE
+#define STACK_CHECK(SIZE, LAST_SRC_LOC) PANIC_ON_FAIL((SIZE) < STACK_SIZE, CISH_ERROR_STACK_OVERFLOW, LAST_SRC_LOC)
+#define FRAME_CHECK(DEPTH, LAST_SRC_LOC) PANIC_ON_FAIL((DEPTH) != FRAME_LIMIT, CISH_ERROR_STACK_OVERFLOW, LAST_SRC_LOC)
+#define RELOAD_FRAME_POINTER
+#endif // GROWABLE_STACK
+
 static heap_alloc_t** heap_allocs; //heap allocations/objects
-static uint16_t* heap_frame_bounds;
+static uint32_t* heap_frame_bounds;
 
 static heap_alloc_t** heap_traces; //garbage-collector tracing information
-static uint16_t* trace_frame_bounds;
+static uint32_t* trace_frame_bounds;
+
+/*
+* Remembered set - heap allocations from an older gc-frame that have been written to by a younger gc-frame.
+* Cleaning a frame only traces the frame's own (young) heap allocations, and uses the remembered set to find those that are only reachable through old ones.
+*/
+
+static heap_alloc_t** heap_remembered;
+static uint32_t* remembered_frame_bounds;
+static uint32_t remembered_count, alloced_remembered;
+
+#ifdef INCREMENTAL_GC
+/*
+* Incremental sweeping - cleaning a frame traces it as usual, but its registrations are moved to a sweep queue rather than swept during the clean.
+* The queue is swept a bounded step at a time at safepoints, which are loop back-edges and calls, so pauses don't grow with the amount of garbage a frame leaves.
+* Every gc-frame gets a new epoch when it's opened. Queued registrations whose heap allocs have since been promoted or re-registered carry a different epoch, and are skipped.
+*/
+
+typedef struct sweep_job {
+	uint32_t end, epoch; //end of the job's registrations in the sweep queue, and the epoch of the frame they came from
+} sweep_job_t;
+
+static heap_alloc_t** heap_sweeps;
+static uint32_t sweep_head, sweep_tail, alloced_sweeps;
 
-static heap_alloc_t** freed_heap_allocs; //recycled heap allocations/objects
+static sweep_job_t* sweep_jobs;
+static uint32_t job_head, job_tail, alloced_jobs;
+
+static uint32_t* frame_epochs;
+static uint32_t gc_epoch;
+
+#if defined(ROBOMODE) && !defined(ROBOSIM)
+#define GC_STEP_CLOCK() micros()
+#else
+#define GC_STEP_CLOCK() ((uint64_t)clock() * 1000000 / CLOCKS_PER_SEC)
+#endif // ROBOMODE
+
+#define GC_SWEEP_ALL 0
+#define GC_FRAME_EPOCH frame_epochs[heap_frame] = ++gc_epoch
+#define GC_SAFEPOINT {if (sweep_head != sweep_tail) gc_step(GC_STEP_BUDGET);}
+
+//a recycled heap alloc's registration is stale once its gc-frame has been cleaned, even if a new frame has since been opened at the same depth
+#define REGISTRATION_VALID(HEAP_ALLOC) ((HEAP_ALLOC)->reg_with_table && (HEAP_ALLOC)->gc_frame <= heap_frame && (HEAP_ALLOC)->frame_epoch == frame_epochs[(HEAP_ALLOC)->gc_frame])
+#define REGISTER_FRAME_EPOCH(HEAP_ALLOC) (HEAP_ALLOC)->frame_epoch = frame_epochs[heap_frame]
+#else
+#define GC_FRAME_EPOCH
+#define GC_SAFEPOINT
+#define REGISTRATION_VALID(HEAP_ALLOC) ((HEAP_ALLOC)->reg_with_table)
+#define REGISTER_FRAME_EPOCH(HEAP_ALLOC)
+#endif // INCREMENTAL_GC
+
+#ifdef RC_MODE
+/*
+* Reference counting - heap allocations count the references held by other heap allocations, while references from the stack are deferred.
+* Decremented heap allocations are buffered as candidates. Once enough have been buffered, candidates that are neither counted nor on the stack are freed, and cycles are found by trial deletion.
+* Gc-frames still clean up young heap allocations, reference counting reclaims old ones that have become unreachable.
+*/
+
+#ifndef RC_COLLECT_THRESHOLD
+#define RC_COLLECT_THRESHOLD 256
+#endif // !RC_COLLECT_THRESHOLD
+
+static heap_alloc_t** rc_buffer;
+static uint32_t rc_count, alloced_rc, rc_threshold, rc_cycle_threshold;
+
+static heap_alloc_t** rc_roots; //sorted snapshot of the live part of the stack and gc-frame traces, taken at the start of a collection
+static uint32_t rc_root_count;
+#endif // RC_MODE
+
+/*
+* Slab allocator - a heap allocation's header, registers and status arrays live in a single block.
+* Blocks are carved out of chunks belonging to a size class. Classes up to SLAB_EXACT_CAPACITY hold exactly that many registers, so every record shape gets its own pool, and larger classes hold 32, 64 ... SLAB_MAX_CAPACITY registers.
+* Recycled blocks keep their buffers, and only have their status bits cleared when reused.
+* Larger allocations take a header-only block from class 0, and keep their registers in a detached buffer.
+*/
+
+#define SLAB_EXACT_CAPACITY 16
+#define SLAB_CLASS_COUNT 23
+#define SLAB_MAX_CAPACITY 1024
+#define SLAB_CHUNK_SIZE 65536
+
+#define SLAB_CAPACITY(SIZE_CLASS) ((SIZE_CLASS) <= SLAB_EXACT_CAPACITY ? (uint32_t)(SIZE_CLASS) : (UINT32_C(1) << ((SIZE_CLASS) - 12)))
+#define SLAB_BLOCK_SIZE(CAPACITY) (sizeof(heap_alloc_t) + (CAPACITY) * sizeof(machine_reg_t) + 2 * STAT_WORDS(CAPACITY) * sizeof(uint64_t))
+
+typedef union heap_slab_chunk slab_chunk_t;
+typedef union heap_slab_chunk {
+	slab_chunk_t* next;
+	machine_reg_t align; //keeps the blocks that follow a chunk header register aligned
+} slab_chunk_t;
+
+typedef struct heap_slab {
+	char* bump, *end; //bump allocation window within the newest chunk
+	heap_alloc_t* free_list; //recycled heap allocations/objects
+} heap_slab_t;
+
+static heap_slab_t slabs[SLAB_CLASS_COUNT];
+static slab_chunk_t* slab_chunks;
+
+/*
+* Status bitsets - init_stat and trace_stat hold one bit per register, packed into 64-bit words.
+* Bits at or above an allocation's limit are always kept clear.
+*/
+
+#define STAT_WORDS(COUNT) (((COUNT) + 63) / 64)
+#define STAT_GET(STAT, I) (((STAT)[(I) >> 6] >> ((I) & 63)) & 1)
+#define STAT_SET(STAT, I) ((STAT)[(I) >> 6] |= UINT64_C(1) << ((I) & 63))
+#define STAT_ASSIGN(STAT, I, VAL) ((STAT)[(I) >> 6] = ((STAT)[(I) >> 6] & ~(UINT64_C(1) << ((I) & 63))) | ((uint64_t)((VAL) != 0) << ((I) & 63)))
 
 //some debuging flags
 static cish_error_t last_err;
@@ -207,7 +364,9 @@ static cish_error_t last_err;
 #define PANIC_ON_FAIL(COND, ERR, LAST_SRC_LOC) {if(!(COND)) PANIC(ERR, LAST_SRC_LOC);}
 
 //more runtime stuff
-static uint16_t global_offset, position_count, heap_frame, heap_count, alloced_heap_allocs, trace_count, alloced_trace_allocs, freed_heap_count, alloc_freed_heaps; 
+static uint32_t global_offset;
+static uint16_t position_count, heap_frame;
+static uint32_t heap_count, alloced_heap_allocs, trace_count, alloced_trace_allocs;
 
 static ffi_t ffi_table;
 
@@ -218,15 +377,80 @@ static machine_type_sig_t* defined_signatures;
 static uint16_t defined_sig_count;
 
 static heap_alloc_t** reset_stack;
-static uint16_t reset_count;
-static uint16_t alloced_reset;
+static uint32_t reset_count;
+static uint32_t alloced_reset;
+
+static heap_alloc_t** mark_stack; //pending heap allocations for tracing and freeing
+static uint32_t mark_count;
+static uint32_t alloced_mark;
+
+/*
+* Runtime table capacities - the initial sizes of the runtime's tables, which grow geometrically afterwards.
+* Capote may override these with the high-water marks recorded by a capacity profile.
+*/
+
+#define HEAP_ALLOCS_CAPACITY 1000 //the heap allocation table starts larger than the others, since every allocation is registered in it
+
+//RUNTIME_TABLES is emitted by capote, from the same list it reads capacity profiles with
+#define RUNTIME_TABLE_ENUM(TABLE, NAME) RUNTIME_TABLE_##TABLE,
+typedef enum runtime_table {
+	RUNTIME_TABLES(RUNTIME_TABLE_ENUM)
+	RUNTIME_TABLE_COUNT
+} runtime_table_t;
+#undef RUNTIME_TABLE_ENUM
+
+static uint32_t runtime_capacities[RUNTIME_TABLE_COUNT] = { HEAP_ALLOCS_CAPACITY, 128, 128, 128, 128 };
+
+#ifdef CAPACITY_PROFILE
+
+#define RUNTIME_TABLE_NAME(TABLE, NAME) #NAME,
+static const char* runtime_table_names[RUNTIME_TABLE_COUNT] = { RUNTIME_TABLES(RUNTIME_TABLE_NAME) };
+#undef RUNTIME_TABLE_NAME
+
+static uint32_t capacity_high_water[RUNTIME_TABLE_COUNT];
+
+#define CAPACITY_HIGH_WATER(TABLE, COUNT) {if ((COUNT) > capacity_high_water[TABLE]) capacity_high_water[TABLE] = (COUNT);}
+#else
+#define CAPACITY_HIGH_WATER(TABLE, COUNT)
+#endif // CAPACITY_PROFILE
+
+#ifdef RUNTIME_STATS
+/*
+* Runtime statistics - counters compiled in by capote's -stats flag, and reported to stderr when the program exits.
+*/
+
+typedef struct runtime_stats {
+	uint64_t allocs, recycles, frees;
+	uint64_t gc_cleans, gc_steps, traced, supertraced;
+	clock_t gc_clean_clocks;
+
+	uint32_t peak_heap_count;
+	uint32_t peak_global_offset;
+	uint16_t peak_position_count;
+} runtime_stats_t;
+
+static runtime_stats_t runtime_stats;
+static uint64_t* ffi_call_counts; //calls made to each foreign function id
+
+#define RUNTIME_STATS_COUNT(COUNTER) runtime_stats.COUNTER++;
+#define RUNTIME_STATS_PEAK(COUNTER, VALUE) {if ((VALUE) > runtime_stats.COUNTER) runtime_stats.COUNTER = (VALUE);}
+#define RUNTIME_STATS_CALL_DEPTH {RUNTIME_STATS_PEAK(peak_global_offset, global_offset); RUNTIME_STATS_PEAK(peak_position_count, position_count);}
+#else
+#define RUNTIME_STATS_COUNT(COUNTER)
+#define RUNTIME_STATS_PEAK(COUNTER, VALUE)
+#define RUNTIME_STATS_CALL_DEPTH
+#endif // RUNTIME_STATS
 
 #ifdef CISH_DEBUG
 
 static src_loc_t* src_locs;
 static uint64_t src_loc_count;
 
+#ifdef GROWABLE_STACK
+static uint64_t* src_loc_stack;
+#else
 static uint64_t src_loc_stack[FRAME_LIMIT];
+#endif // GROWABLE_STACK
 static uint64_t last_src_loc;
 
 static void print_back_trace() {
@@ -255,53 +479,217 @@ static void print_back_trace() {
 
 #endif // CISH_DEBUG
 
+#ifdef HEAP_PROFILE
+/*
+* Heap profiler - allocations are counted against the source location that made them, which is set before every allocating instruction.
+* Sites also count the heap allocations that outlived their gc-frame or were supertraced, and are reported to stderr when the program exits.
+*/
+
+#ifndef CISH_DEBUG
+#error Heap profiling requires debug source locations.
+#endif // !CISH_DEBUG
+
+typedef enum heap_site_flag {
+	HEAP_SITE_SURVIVED = 1,
+	HEAP_SITE_SUPERTRACED = 2
+} heap_site_flag_t;
+
+typedef struct heap_site {
+	uint64_t allocs, bytes, survived, supertraced;
+} heap_site_t;
+
+static heap_site_t* heap_sites;
+static uint64_t heap_profile_loc; //source location of the allocating instruction being run
+
+#define HEAP_PROFILE_LOC(SRC_LOC) heap_profile_loc = SRC_LOC;
+#define HEAP_PROFILE_FLAG(HEAP_ALLOC, FLAG, COUNTER) do { \
+	if (!((HEAP_ALLOC)->site_flags & (FLAG))) { \
+		(HEAP_ALLOC)->site_flags |= (FLAG); \
+		heap_sites[(HEAP_ALLOC)->alloc_site].COUNTER++; \
+	} \
+} while (0)
+
+static int init_heap_profile() {
+	ESCAPE_ON_FAIL(heap_sites = calloc(src_loc_count, sizeof(heap_site_t)));
+	return 1;
+}
+
+static int compare_heap_sites(const void* a, const void* b) {
+	uint64_t bytes_a = heap_sites[*(uint64_t*)a].bytes;
+	uint64_t bytes_b = heap_sites[*(uint64_t*)b].bytes;
+	return (bytes_a < bytes_b) - (bytes_a > bytes_b);
+}
+
+//prints every allocation site, the sites that allocated the most bytes first
+static void print_heap_profile() {
+	uint64_t* site_order = malloc(src_loc_count * sizeof(uint64_t));
+	if (!site_order)
+		return;
+
+	uint64_t site_count = 0;
+	for (uint_fast64_t i = 0; i < src_loc_count; i++)
+		if (heap_sites[i].allocs)
+			site_order[site_count++] = i;
+	qsort(site_order, site_count, sizeof(uint64_t), compare_heap_sites);
+
+	fputs("\n-- heap profile --\nbytes\tallocs\tsurvived\tsupertraced\tsite\n", stderr);
+	for (uint_fast64_t i = 0; i < site_count; i++) {
+		heap_site_t site = heap_sites[site_order[i]];
+		src_loc_t src_loc = src_locs[site_order[i]];
+
+		const char* line = src_loc.line;
+		while (*line == ' ' || *line == '\t')
+			line++;
+		fprintf(stderr, "%"PRIu64"\t%"PRIu64"\t%"PRIu64"\t%"PRIu64"\t%s:%i:%i: %s\n", site.bytes, site.allocs, site.survived, site.supertraced, src_loc.file_name, src_loc.row, src_loc.col, line);
+	}
+	free(site_order);
+}
+#else
+#define HEAP_PROFILE_LOC(SRC_LOC)
+#define HEAP_PROFILE_FLAG(HEAP_ALLOC, FLAG, COUNTER) do {} while (0)
+#endif // HEAP_PROFILE
+
 static int ffi_invoke(ffi_t* ffi_table, machine_reg_t* id_reg, machine_reg_t* in_reg, machine_reg_t* out_reg) {
 	if (id_reg->long_int >= ffi_table->func_count || id_reg->long_int < 0)
 		return 0;
+#ifdef RUNTIME_STATS
+	ffi_call_counts[id_reg->long_int]++;
+#endif // RUNTIME_STATS
 	return ffi_table->func_table[id_reg->long_int](in_reg, out_reg);
 }
 
-heap_alloc_t* alloc(uint16_t req_size, gc_trace_mode_t trace_mode) {
-#define CHECK_HEAP_COUNT if(heap_count == UINT16_MAX) \
+//gets the size class of a heap allocation with req_size registers
+static inline uint8_t slab_class(uint32_t req_size) {
+	if (req_size <= SLAB_EXACT_CAPACITY)
+		return req_size;
+	if (req_size > SLAB_MAX_CAPACITY)
+		return 0;
+	return 12 + (32 - __builtin_clz(req_size - 1));
+}
+
+//carves a new block out of a size class's chunk, allocating a new chunk when the current one is exhausted
+static heap_alloc_t* slab_alloc(uint8_t size_class) {
+	heap_slab_t* slab = &slabs[size_class];
+	size_t block_size = SLAB_BLOCK_SIZE(SLAB_CAPACITY(size_class));
+
+	if (slab->bump == slab->end) {
+		size_t chunk_blocks = block_size < SLAB_CHUNK_SIZE ? SLAB_CHUNK_SIZE / block_size : 1;
+		slab_chunk_t* chunk = malloc(sizeof(slab_chunk_t) + chunk_blocks * block_size);
+		ESCAPE_ON_FAIL(chunk);
+		chunk->next = slab_chunks;
+		slab_chunks = chunk;
+		slab->bump = (char*)(chunk + 1);
+		slab->end = slab->bump + chunk_blocks * block_size;
+	}
+
+	heap_alloc_t* heap_alloc = (heap_alloc_t*)slab->bump;
+	slab->bump += block_size;
+	heap_alloc->size_class = size_class;
+	return heap_alloc;
+}
+
+//initializes a heap allocation's header and points its registers and status arrays at its block, init status is only cleared if it'll be tracked
+static inline int init_heap_alloc(heap_alloc_t* heap_alloc, uint32_t req_size, gc_trace_mode_t trace_mode, int track_init) {
+	RUNTIME_STATS_COUNT(allocs);
+#ifdef HEAP_PROFILE
+	heap_alloc->alloc_site = heap_profile_loc;
+	heap_alloc->site_flags = 0;
+	heap_sites[heap_profile_loc].allocs++;
+	heap_sites[heap_profile_loc].bytes += SLAB_BLOCK_SIZE(req_size);
+#endif // HEAP_PROFILE
+	heap_alloc->pre_freed = 0;
+	heap_alloc->limit = req_size;
+	heap_alloc->gc_flag = 0;
+	heap_alloc->trace_mode = trace_mode;
+	heap_alloc->type_sig = NULL;
+	heap_alloc->remembered_frame = UINT16_MAX;
+#ifdef RC_MODE
+	heap_alloc->ref_count = 0;
+	heap_alloc->rc_color = RC_BLACK;
+	heap_alloc->rc_buffered = 0;
+#endif // RC_MODE
+
+	if (req_size <= SLAB_CAPACITY(heap_alloc->size_class)) {
+		heap_alloc->detached = 0;
+		heap_alloc->registers = (machine_reg_t*)(heap_alloc + 1);
+		heap_alloc->init_stat = (uint64_t*)(heap_alloc->registers + SLAB_CAPACITY(heap_alloc->size_class));
+		heap_alloc->trace_stat = heap_alloc->init_stat + STAT_WORDS(SLAB_CAPACITY(heap_alloc->size_class));
+		if (track_init)
+			memset(heap_alloc->init_stat, 0, STAT_WORDS(req_size) * sizeof(uint64_t));
+		if (trace_mode == GC_TRACE_MODE_SOME)
+			memset(heap_alloc->trace_stat, 0, STAT_WORDS(req_size) * sizeof(uint64_t));
+	}
+	else {
+		heap_alloc->detached = 1;
+		PANIC_ON_FAIL(heap_alloc->registers = malloc(req_size * sizeof(machine_reg_t)), CISH_ERROR_MEMORY, 0);
+		PANIC_ON_FAIL(heap_alloc->init_stat = track_init ? calloc(STAT_WORDS(req_size), sizeof(uint64_t)) : malloc(STAT_WORDS(req_size) * sizeof(uint64_t)), CISH_ERROR_MEMORY, 0);
+		if (trace_mode == GC_TRACE_MODE_SOME)
+			PANIC_ON_FAIL(heap_alloc->trace_stat = calloc(STAT_WORDS(req_size), sizeof(uint64_t)), CISH_ERROR_MEMORY, 0);
+	}
+	return 1;
+}
+
+heap_alloc_t* alloc(uint32_t req_size, gc_trace_mode_t trace_mode) {
+#define CHECK_HEAP_COUNT if(heap_count == UINT32_MAX) \
 							PANIC(CISH_ERROR_MEMORY, 0); \
 						if (heap_count == alloced_heap_allocs) { \
-							heap_alloc_t** new_heap_allocs = realloc(heap_allocs, (alloced_heap_allocs += 100) * sizeof(heap_alloc_t*)); \
+							heap_alloc_t** new_heap_allocs = realloc(heap_allocs, (alloced_heap_allocs *= 2) * sizeof(heap_alloc_t*)); \
 							PANIC_ON_FAIL(new_heap_allocs, CISH_ERROR_MEMORY, 0); \
 							heap_allocs = new_heap_allocs; \
 						}
 
 	heap_alloc_t* heap_alloc;
-	if (freed_heap_count) {
-		heap_alloc = freed_heap_allocs[--freed_heap_count];
-		if (!heap_alloc->reg_with_table) {
+	heap_slab_t* slab = &slabs[slab_class(req_size)];
+	if (slab->free_list) {
+		heap_alloc = slab->free_list;
+		slab->free_list = heap_alloc->next_free;
+		RUNTIME_STATS_COUNT(recycles);
+		if (!REGISTRATION_VALID(heap_alloc)) {
 			CHECK_HEAP_COUNT;
 			heap_allocs[heap_count++] = heap_alloc;
 			heap_alloc->reg_with_table = 1;
+			heap_alloc->gc_frame = heap_frame;
+			REGISTER_FRAME_EPOCH(heap_alloc);
 		}
 	}
 	else {
-		heap_alloc = malloc(sizeof(heap_alloc_t));
-		PANIC_ON_FAIL(heap_alloc, CISH_ERROR_MEMORY, 0);
 		CHECK_HEAP_COUNT;
+		PANIC_ON_FAIL(heap_alloc = slab_alloc(slab_class(req_size)), CISH_ERROR_MEMORY, 0);
 		heap_allocs[heap_count++] = heap_alloc;
 		heap_alloc->reg_with_table = 1;
+		heap_alloc->gc_frame = heap_frame;
+		REGISTER_FRAME_EPOCH(heap_alloc);
 	}
-	heap_alloc->pre_freed = 0;
-	heap_alloc->limit = req_size;
-	heap_alloc->gc_flag = 0;
-	heap_alloc->trace_mode = trace_mode;
-	heap_alloc->type_sig = NULL;
-	PANIC_ON_FAIL(heap_alloc, CISH_ERROR_MEMORY, 0);
-	if (req_size) {
-		PANIC_ON_FAIL(heap_alloc->registers = malloc(req_size * sizeof(machine_reg_t)), CISH_ERROR_MEMORY, 0);
-		PANIC_ON_FAIL(heap_alloc->init_stat = calloc(req_size, sizeof(int)), CISH_ERROR_MEMORY, 0);
-		if (trace_mode == GC_TRACE_MODE_SOME)
-			PANIC_ON_FAIL(heap_alloc->trace_stat = malloc(req_size * sizeof(int)), CISH_ERROR_MEMORY, 0);
-	}
+	ESCAPE_ON_FAIL(init_heap_alloc(heap_alloc, req_size, trace_mode, 1));
 	return heap_alloc;
 #undef CHECK_HEAP_COUNT
 }
 
+//inlined allocation fast path, takes a recycled block or bumps a fresh one and falls back to alloc otherwise
+#define ALLOC_I_FAST(DEST, SIZE, TRACE_MODE, TRACK_INIT, LAST_SRC_LOC) { \
+	heap_slab_t* slab = &slabs[slab_class(SIZE)]; \
+	heap_alloc_t* heap_alloc = slab->free_list; \
+	if (heap_alloc ? REGISTRATION_VALID(heap_alloc) : (slab->bump != slab->end && heap_count != alloced_heap_allocs)) { \
+		if (heap_alloc) { \
+			slab->free_list = heap_alloc->next_free; \
+			RUNTIME_STATS_COUNT(recycles); \
+		} \
+		else { \
+			heap_alloc = (heap_alloc_t*)slab->bump; \
+			slab->bump += SLAB_BLOCK_SIZE(SLAB_CAPACITY(slab_class(SIZE))); \
+			heap_alloc->size_class = slab_class(SIZE); \
+			heap_alloc->reg_with_table = 1; \
+			heap_alloc->gc_frame = heap_frame; \
+			REGISTER_FRAME_EPOCH(heap_alloc); \
+			heap_allocs[heap_count++] = heap_alloc; \
+		} \
+		PANIC_ON_FAIL(init_heap_alloc(heap_alloc, SIZE, TRACE_MODE, TRACK_INIT), CISH_ERROR_MEMORY, LAST_SRC_LOC); \
+	} \
+	else \
+		PANIC_ON_FAIL(heap_alloc = alloc(SIZE, TRACE_MODE), CISH_ERROR_MEMORY, LAST_SRC_LOC); \
+	DEST = heap_alloc; \
+}
+
 static int install_stdlib();
 static int init_runtime(int type_table_size) {
 	last_err = CISH_ERROR_NONE;
@@ -310,21 +698,94 @@ static int init_runtime(int type_table_size) {
 	heap_frame = 0;
 	heap_count = 0;
 	trace_count = 0;
-	freed_heap_count = 0;
+	remembered_count = 0;
 	defined_sig_count = 0;
 	reset_count = 0;
-
-	ESCAPE_ON_FAIL(heap_allocs = malloc((alloced_heap_allocs = FRAME_LIMIT) * sizeof(heap_alloc_t*)));
-	ESCAPE_ON_FAIL(heap_traces = malloc((alloced_trace_allocs = 128) * sizeof(heap_alloc_t*)));
-	ESCAPE_ON_FAIL(heap_frame_bounds = malloc(FRAME_LIMIT * sizeof(uint16_t)));
-	ESCAPE_ON_FAIL(trace_frame_bounds = malloc(FRAME_LIMIT * sizeof(uint16_t)));
-	ESCAPE_ON_FAIL(freed_heap_allocs = malloc((alloc_freed_heaps = 128) * sizeof(heap_alloc_t*)));
+	mark_count = 0;
+	slab_chunks = NULL;
+	memset(slabs, 0, sizeof(slabs));
+
+	ESCAPE_ON_FAIL(heap_allocs = malloc((alloced_heap_allocs = runtime_capacities[RUNTIME_TABLE_HEAP_ALLOCS]) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(heap_traces = malloc((alloced_trace_allocs = runtime_capacities[RUNTIME_TABLE_HEAP_TRACES]) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(heap_frame_bounds = malloc(FRAME_LIMIT * sizeof(uint32_t)));
+	ESCAPE_ON_FAIL(trace_frame_bounds = malloc(FRAME_LIMIT * sizeof(uint32_t)));
+	ESCAPE_ON_FAIL(heap_remembered = malloc((alloced_remembered = runtime_capacities[RUNTIME_TABLE_REMEMBERED]) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(remembered_frame_bounds = malloc(FRAME_LIMIT * sizeof(uint32_t)));
 	ESCAPE_ON_FAIL(type_table = calloc(type_table_size, sizeof(uint16_t)));
+#ifdef GROWABLE_STACK
+	ESCAPE_ON_FAIL(stack = calloc(stack_limit = STACK_SIZE, sizeof(machine_reg_t)));
+	ESCAPE_ON_FAIL(positions = malloc((frame_limit = FRAME_LIMIT) * sizeof(void*)));
+#ifdef CISH_DEBUG
+	ESCAPE_ON_FAIL(src_loc_stack = malloc(FRAME_LIMIT * sizeof(uint64_t)));
+#endif // CISH_DEBUG
+#endif // GROWABLE_STACK
 	//ESCAPE_ON_FAIL(defined_signatures = malloc((alloced_sig_defs = 16) * sizeof(machine_type_sig_t)));
-	ESCAPE_ON_FAIL(reset_stack = malloc((alloced_reset = 128) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(reset_stack = malloc((alloced_reset = runtime_capacities[RUNTIME_TABLE_RESET_STACK]) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(mark_stack = malloc((alloced_mark = runtime_capacities[RUNTIME_TABLE_MARK_STACK]) * sizeof(heap_alloc_t*)));
+#ifdef INCREMENTAL_GC
+	sweep_head = sweep_tail = 0;
+	job_head = job_tail = 0;
+	gc_epoch = 0;
+	ESCAPE_ON_FAIL(heap_sweeps = malloc((alloced_sweeps = runtime_capacities[RUNTIME_TABLE_HEAP_ALLOCS]) * sizeof(heap_alloc_t*)));
+	ESCAPE_ON_FAIL(sweep_jobs = malloc((alloced_jobs = 16) * sizeof(sweep_job_t)));
+	ESCAPE_ON_FAIL(frame_epochs = calloc(FRAME_LIMIT + 1, sizeof(uint32_t)));
+#endif // INCREMENTAL_GC
+#ifdef RC_MODE
+	rc_count = 0;
+	rc_threshold = RC_COLLECT_THRESHOLD;
+	rc_cycle_threshold = RC_COLLECT_THRESHOLD;
+	ESCAPE_ON_FAIL(rc_buffer = malloc((alloced_rc = RC_COLLECT_THRESHOLD) * sizeof(heap_alloc_t*)));
+#endif // RC_MODE
 	ESCAPE_ON_FAIL(install_stdlib());
+#ifdef RUNTIME_STATS
+	memset(&runtime_stats, 0, sizeof(runtime_stats_t));
+	ESCAPE_ON_FAIL(ffi_call_counts = calloc(ffi_table.func_count, sizeof(uint64_t)));
+#endif // RUNTIME_STATS
+	return 1;
+}
+
+#ifdef GROWABLE_STACK
+//grows the register stack until it can hold required registers, the new registers are zeroed like a static stack's
+static int grow_stack(uint32_t required) {
+	uint32_t new_limit = stack_limit;
+	while (new_limit <= required) {
+		ESCAPE_ON_FAIL(new_limit <= UINT32_MAX / 2);
+		new_limit *= 2;
+	}
+	machine_reg_t* new_stack = realloc(stack, new_limit * sizeof(machine_reg_t));
+	ESCAPE_ON_FAIL(new_stack);
+	memset(&new_stack[stack_limit], 0, (new_limit - stack_limit) * sizeof(machine_reg_t));
+	stack = new_stack;
+	stack_limit = new_limit;
+	return 1;
+}
+
+#define GROW_FRAME_TABLE(TABLE, TYPE, COUNT) { \
+	TYPE* new_table = realloc(TABLE, (COUNT) * sizeof(TYPE)); \
+	ESCAPE_ON_FAIL(new_table); \
+	TABLE = new_table; \
+}
+
+//grows the call stack and every per-frame table with it, gc-frames are numbered by 16 bit integers so the frame limit can't pass UINT16_MAX
+static int grow_frames() {
+	ESCAPE_ON_FAIL(frame_limit < UINT16_MAX - 1);
+	uint16_t new_limit = frame_limit > (UINT16_MAX - 1) / 2 ? UINT16_MAX - 1 : frame_limit * 2;
+
+	GROW_FRAME_TABLE(positions, void*, new_limit);
+	GROW_FRAME_TABLE(heap_frame_bounds, uint32_t, new_limit);
+	GROW_FRAME_TABLE(trace_frame_bounds, uint32_t, new_limit);
+	GROW_FRAME_TABLE(remembered_frame_bounds, uint32_t, new_limit);
+#ifdef CISH_DEBUG
+	GROW_FRAME_TABLE(src_loc_stack, uint64_t, new_limit);
+#endif // CISH_DEBUG
+#ifdef INCREMENTAL_GC
+	GROW_FRAME_TABLE(frame_epochs, uint32_t, new_limit + 1);
+#endif // INCREMENTAL_GC
+	frame_limit = new_limit;
 	return 1;
 }
+#undef GROW_FRAME_TABLE
+#endif // GROWABLE_STACK
 
 static void free_type_signature(machine_type_sig_t* type_sig) {
 	if (type_sig->super_signature != 3 && type_sig->sub_type_count) {
@@ -335,7 +796,8 @@ static void free_type_signature(machine_type_sig_t* type_sig) {
 }
 
 static void free_heap_alloc(heap_alloc_t* heap_alloc) {
-	if (heap_alloc->limit) {
+	RUNTIME_STATS_COUNT(frees);
+	if (heap_alloc->detached) {
 		free(heap_alloc->registers);
 		free(heap_alloc->init_stat);
 		if (heap_alloc->trace_mode == GC_TRACE_MODE_SOME)
@@ -347,56 +809,416 @@ static void free_heap_alloc(heap_alloc_t* heap_alloc) {
 	}
 }
 
-static int recycle_heap_alloc(heap_alloc_t* heap_alloc) {
-	if (freed_heap_count == alloc_freed_heaps) {
-		heap_alloc_t** new_freed_heaps = realloc(freed_heap_allocs, (alloc_freed_heaps += 10) * sizeof(heap_alloc_t*));
-		PANIC_ON_FAIL(new_freed_heaps, CISH_ERROR_MEMORY, 0);
-		freed_heap_allocs = new_freed_heaps;
+static void recycle_heap_alloc(heap_alloc_t* heap_alloc) {
+#ifdef RC_MODE
+	if (heap_alloc->rc_buffered) {
+		heap_alloc->rc_color = RC_FREED;
+		return;
+	}
+#endif // RC_MODE
+	heap_alloc->next_free = slabs[heap_alloc->size_class].free_list;
+	slabs[heap_alloc->size_class].free_list = heap_alloc;
+}
+
+//gets a word of a heap allocation's traced children bitset, a child is traced if it's initialized and of a traced type
+static inline uint64_t traced_children(heap_alloc_t* heap_alloc, uint_fast32_t word) {
+	switch (heap_alloc->trace_mode) {
+	case GC_TRACE_MODE_ALL:
+		return heap_alloc->init_stat[word];
+	case GC_TRACE_MODE_SOME:
+		return heap_alloc->init_stat[word] & heap_alloc->trace_stat[word];
+	default:
+		return 0;
+	}
+}
+
+//pushes a heap allocation onto the mark stack, and prefetches its header for when it's popped
+static inline int push_mark(heap_alloc_t* heap_alloc) {
+	if (mark_count == alloced_mark) {
+		heap_alloc_t** new_mark_stack = realloc(mark_stack, (alloced_mark *= 2) * sizeof(heap_alloc_t*));
+		PANIC_ON_FAIL(new_mark_stack, CISH_ERROR_MEMORY, 0);
+		mark_stack = new_mark_stack;
+	}
+	__builtin_prefetch(heap_alloc);
+	mark_stack[mark_count++] = heap_alloc;
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_MARK_STACK, mark_count);
+	return 1;
+}
+
+#ifdef RC_MODE
+//checks whether a register of a heap allocation holds a counted reference
+static inline int rc_traced(heap_alloc_t* heap_alloc, uint_fast32_t reg) {
+	switch (heap_alloc->trace_mode) {
+	case GC_TRACE_MODE_ALL:
+		return 1;
+	case GC_TRACE_MODE_SOME:
+		return STAT_GET(heap_alloc->trace_stat, reg);
+	default:
+		return 0;
+	}
+}
+
+//buffers a heap allocation as a candidate for the next collection
+static int rc_buffer_alloc(heap_alloc_t* heap_alloc) {
+	heap_alloc->rc_color = RC_PURPLE;
+	if (heap_alloc->rc_buffered)
+		return 1;
+	if (rc_count == alloced_rc) {
+		heap_alloc_t** new_rc_buffer = realloc(rc_buffer, (alloced_rc *= 2) * sizeof(heap_alloc_t*));
+		PANIC_ON_FAIL(new_rc_buffer, CISH_ERROR_MEMORY, 0);
+		rc_buffer = new_rc_buffer;
 	}
-	freed_heap_allocs[freed_heap_count++] = heap_alloc;
+	rc_buffer[rc_count++] = heap_alloc;
+	heap_alloc->rc_buffered = 1;
 	return 1;
 }
 
+static inline void rc_retain(heap_alloc_t* heap_alloc) {
+	heap_alloc->ref_count++;
+	heap_alloc->rc_color = RC_BLACK;
+}
+
+static inline int rc_release(heap_alloc_t* heap_alloc) {
+	heap_alloc->ref_count--;
+	return rc_buffer_alloc(heap_alloc);
+}
+
+//releases the references held by a heap allocation that its gc-frame is freeing, children freed alongside it aren't released
+static int rc_release_survivors(heap_alloc_t* heap_alloc) {
+	if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+		for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+			for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+				heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+				if (child->gc_flag || child->gc_frame <= heap_frame)
+					ESCAPE_ON_FAIL(rc_release(child));
+			}
+	return 1;
+}
+
+static int rc_compare_roots(const void* a, const void* b) {
+	uintptr_t root_a = (uintptr_t)*(heap_alloc_t**)a;
+	uintptr_t root_b = (uintptr_t)*(heap_alloc_t**)b;
+	return (root_a > root_b) - (root_a < root_b);
+}
+
+//checks whether a heap allocation may still be referenced by the stack or a gc-frame, stack registers that merely look like the heap allocation keep it alive
+static int rc_rooted(heap_alloc_t* heap_alloc) {
+	return bsearch(&heap_alloc, rc_roots, rc_root_count, sizeof(heap_alloc_t*), rc_compare_roots) != NULL;
+}
+
+//frees a candidate that's neither counted nor on the stack, along with any children it held the last reference to
+static int rc_free(heap_alloc_t* root) {
+	root->rc_color = RC_FREED;
+	mark_count = 0;
+	ESCAPE_ON_FAIL(push_mark(root));
+	while (mark_count) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					if (!--child->ref_count && !child->rc_buffered && !rc_rooted(child)) {
+						child->rc_color = RC_FREED;
+						ESCAPE_ON_FAIL(push_mark(child));
+					}
+					else
+						ESCAPE_ON_FAIL(rc_buffer_alloc(child));
+				}
+		heap_alloc->pre_freed = 1;
+		heap_alloc->gc_flag = 0;
+		free_heap_alloc(heap_alloc);
+		recycle_heap_alloc(heap_alloc);
+	}
+	return 1;
+}
+
+//subtracts the references internal to the subgraph below a candidate
+static int rc_mark_gray(heap_alloc_t* root, uint32_t* visited) {
+	root->rc_color = RC_GRAY;
+	mark_count = 0;
+	ESCAPE_ON_FAIL(push_mark(root));
+	while (mark_count) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		++*visited;
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					child->ref_count--;
+					if (child->rc_color != RC_GRAY) {
+						child->rc_color = RC_GRAY;
+						ESCAPE_ON_FAIL(push_mark(child));
+					}
+				}
+	}
+	return 1;
+}
+
+//restores the references subtracted below a heap allocation that's still referenced externally, shares the mark stack with rc_scan
+static int rc_scan_black(heap_alloc_t* root) {
+	uint32_t mark_base = mark_count;
+	root->rc_color = RC_BLACK;
+	ESCAPE_ON_FAIL(push_mark(root));
+	while (mark_count > mark_base) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					child->ref_count++;
+					if (child->rc_color != RC_BLACK) {
+						child->rc_color = RC_BLACK;
+						ESCAPE_ON_FAIL(push_mark(child));
+					}
+				}
+	}
+	return 1;
+}
+
+//whitens the gray heap allocations without any external references
+static int rc_scan(heap_alloc_t* root) {
+	mark_count = 0;
+	ESCAPE_ON_FAIL(push_mark(root));
+	while (mark_count) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->rc_color != RC_GRAY)
+			continue;
+		if (heap_alloc->ref_count || rc_rooted(heap_alloc))
+			ESCAPE_ON_FAIL(rc_scan_black(heap_alloc))
+		else {
+			heap_alloc->rc_color = RC_WHITE;
+			if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+				for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+					for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+						heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+						if (child->rc_color == RC_GRAY)
+							ESCAPE_ON_FAIL(push_mark(child));
+					}
+		}
+	}
+	return 1;
+}
+
+//frees a white subgraph, surviving children left without any counted references are buffered again
+static int rc_collect_white(heap_alloc_t* root, uint32_t* visited) {
+	root->rc_color = RC_FREED;
+	mark_count = 0;
+	ESCAPE_ON_FAIL(push_mark(root));
+	while (mark_count) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					if (child->rc_color == RC_WHITE && !child->rc_buffered) {
+						child->rc_color = RC_FREED;
+						ESCAPE_ON_FAIL(push_mark(child));
+					}
+					else if (child->rc_color == RC_BLACK && !child->ref_count)
+						ESCAPE_ON_FAIL(rc_buffer_alloc(child));
+				}
+		--*visited;
+		heap_alloc->pre_freed = 1;
+		heap_alloc->gc_flag = 0;
+		free_heap_alloc(heap_alloc);
+		recycle_heap_alloc(heap_alloc);
+	}
+	return 1;
+}
+
+//collects the buffered candidates that are neither counted nor on the stack
+//the remaining candidates are searched for garbage cycles by trial deletion, which isn't repeated until as many candidates have been buffered as live heap allocations it visited
+static int rc_collect() {
+	//registers past the current frame's span belong to frames that have already returned
+	uint32_t live_stack = global_offset + RC_FRAME_SPAN < STACK_LIMIT ? global_offset + RC_FRAME_SPAN : STACK_LIMIT;
+	PANIC_ON_FAIL(rc_roots = malloc((live_stack + trace_count) * sizeof(heap_alloc_t*)), CISH_ERROR_MEMORY, 0);
+	for (uint_fast32_t i = 0; i < live_stack; i++)
+		rc_roots[i] = stack[i].heap_alloc;
+	memcpy(&rc_roots[live_stack], heap_traces, trace_count * sizeof(heap_alloc_t*));
+	rc_root_count = live_stack + trace_count;
+	qsort(rc_roots, rc_root_count, sizeof(heap_alloc_t*), rc_compare_roots);
+
+	//candidates buffered while freeing are appended, and visited by the same loop
+	uint32_t candidate_count = 0;
+	for (uint_fast32_t i = 0; i < rc_count; i++) {
+		heap_alloc_t* candidate = rc_buffer[i];
+		if (candidate->rc_color != RC_PURPLE) {
+			candidate->rc_buffered = 0;
+			if (candidate->rc_color == RC_FREED)
+				recycle_heap_alloc(candidate);
+		}
+		else if (!candidate->ref_count && !rc_rooted(candidate)) {
+			candidate->rc_buffered = 0;
+			ESCAPE_ON_FAIL(rc_free(candidate));
+		}
+		else
+			rc_buffer[candidate_count++] = candidate;
+	}
+	rc_count = candidate_count;
+
+	if (rc_count >= rc_cycle_threshold) {
+		uint32_t visited = 0;
+		for (uint_fast32_t i = 0; i < candidate_count; i++) {
+			heap_alloc_t* candidate = rc_buffer[i];
+			if (candidate->rc_color == RC_PURPLE)
+				ESCAPE_ON_FAIL(rc_mark_gray(candidate, &visited));
+		}
+		for (uint_fast32_t i = 0; i < candidate_count; i++)
+			ESCAPE_ON_FAIL(rc_scan(rc_buffer[i]));
+
+		//candidates only referenced by the stack are kept in the buffer, followed by any heap allocations buffered while freeing
+		uint32_t survivor_count = 0;
+		for (uint_fast32_t i = 0; i < candidate_count; i++) {
+			heap_alloc_t* candidate = rc_buffer[i];
+			candidate->rc_buffered = 0;
+			if (candidate->rc_color == RC_WHITE)
+				ESCAPE_ON_FAIL(rc_collect_white(candidate, &visited))
+			else if (!candidate->ref_count) {
+				candidate->rc_color = RC_PURPLE;
+				candidate->rc_buffered = 1;
+				rc_buffer[survivor_count++] = candidate;
+			}
+		}
+		memmove(&rc_buffer[survivor_count], &rc_buffer[candidate_count], (rc_count - candidate_count) * sizeof(heap_alloc_t*));
+		rc_count = survivor_count + (rc_count - candidate_count);
+		rc_cycle_threshold = visited > RC_COLLECT_THRESHOLD ? visited : RC_COLLECT_THRESHOLD;
+	}
+	rc_threshold = rc_count < RC_COLLECT_THRESHOLD / 2 ? RC_COLLECT_THRESHOLD : rc_count * 2;
+
+	free(rc_roots);
+	return 1;
+}
+
+//buffers what a local referenced before it was overwritten or went out of scope, since references from the stack aren't counted it may have been the last one
+//unlike freeing a local, this doesn't skip traced heap allocations, which become old once their gc-frame is cleaned
+static int rc_release_local(heap_alloc_t* heap_alloc) {
+	if (heap_alloc->pre_freed)
+		return 1;
+	ESCAPE_ON_FAIL(rc_buffer_alloc(heap_alloc));
+	return rc_count < rc_threshold || rc_collect();
+}
+
+#define RC_WRITE_BARRIER(HEAP_ALLOC, REG, VALUE, LAST_SRC_LOC) if (rc_traced(HEAP_ALLOC, REG)) { \
+	rc_retain((VALUE).heap_alloc); \
+	if (STAT_GET((HEAP_ALLOC)->init_stat, REG)) \
+		PANIC_ON_FAIL(rc_release((HEAP_ALLOC)->registers[REG].heap_alloc), CISH_ERROR_MEMORY, LAST_SRC_LOC); \
+	if (rc_count >= rc_threshold) \
+		PANIC_ON_FAIL(rc_collect(), CISH_ERROR_MEMORY, LAST_SRC_LOC); \
+}
+#else
+#define RC_WRITE_BARRIER(HEAP_ALLOC, REG, VALUE, LAST_SRC_LOC)
+#endif // RC_MODE
+
 static int free_alloc(heap_alloc_t* heap_alloc) {
 	if (heap_alloc->pre_freed || heap_alloc->gc_flag)
 		return 1;
+#ifdef RC_MODE
+	//the local being freed may still be counted by other heap allocations, so it's only buffered as a candidate
+	ESCAPE_ON_FAIL(rc_buffer_alloc(heap_alloc));
+	return rc_count < rc_threshold || rc_collect();
+#else
 	heap_alloc->pre_freed = 1;
 
-	switch (heap_alloc->trace_mode) {
-	case GC_TRACE_MODE_ALL:
-		for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-			if (heap_alloc->init_stat[i])
-				ESCAPE_ON_FAIL(free_alloc(heap_alloc->registers[i].heap_alloc));
-		break;
-	case GC_TRACE_MODE_SOME:
-		if (heap_alloc->limit) {
-			for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-				if (heap_alloc->init_stat[i] && heap_alloc->trace_stat[i])
-					ESCAPE_ON_FAIL(free_alloc(heap_alloc->registers[i].heap_alloc));
-		}
-		break;
+	mark_count = 0;
+	ESCAPE_ON_FAIL(push_mark(heap_alloc));
+	while (mark_count) {
+		heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					if (!(child->pre_freed || child->gc_flag)) {
+						child->pre_freed = 1;
+						ESCAPE_ON_FAIL(push_mark(child));
+					}
+				}
+		free_heap_alloc(heap_alloc);
+		recycle_heap_alloc(heap_alloc);
 	}
-	free_heap_alloc(heap_alloc);
-	return recycle_heap_alloc(heap_alloc);
+	return 1;
+#endif // RC_MODE
 }
 
+#ifdef RUNTIME_STATS
+static void print_runtime_stats() {
+	RUNTIME_STATS_PEAK(peak_heap_count, heap_count);
+
+	fputs("\n-- runtime statistics --\n", stderr);
+	fprintf(stderr, "allocations: %"PRIu64"\n", runtime_stats.allocs);
+	fprintf(stderr, "recycled allocations: %"PRIu64"\n", runtime_stats.recycles);
+	fprintf(stderr, "freed allocations: %"PRIu64"\n", runtime_stats.frees);
+	fprintf(stderr, "gc cleans: %"PRIu64"\n", runtime_stats.gc_cleans);
+	fprintf(stderr, "gc clean time: %.3f ms\n", runtime_stats.gc_clean_clocks * 1000.0 / CLOCKS_PER_SEC);
+#ifdef INCREMENTAL_GC
+	fprintf(stderr, "incremental gc steps: %"PRIu64"\n", runtime_stats.gc_steps);
+#endif // INCREMENTAL_GC
+	fprintf(stderr, "traced: %"PRIu64"\n", runtime_stats.traced);
+	fprintf(stderr, "supertraced: %"PRIu64"\n", runtime_stats.supertraced);
+	fprintf(stderr, "peak heap count: %"PRIu32"\n", runtime_stats.peak_heap_count);
+	fprintf(stderr, "peak stack offset: %"PRIu32"\n", runtime_stats.peak_global_offset);
+	fprintf(stderr, "peak call depth: %"PRIu16"\n", runtime_stats.peak_position_count);
+	for (uint_fast16_t i = 0; i < ffi_table.func_count; i++)
+		if (ffi_call_counts[i])
+			fprintf(stderr, "foreign calls to %"PRIuFAST16": %"PRIu64"\n", i, ffi_call_counts[i]);
+}
+#endif // RUNTIME_STATS
+
 static void free_runtime() {
-	for (uint_fast16_t i = 0; i < freed_heap_count; i++)
-		free(freed_heap_allocs[i]);
+#ifdef CAPACITY_PROFILE
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_HEAP_ALLOCS, heap_count);
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_HEAP_TRACES, trace_count);
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_REMEMBERED, remembered_count);
+
+	FILE* profile = fopen(CAPACITY_PROFILE, "w");
+	if (profile) {
+		for (uint_fast8_t i = 0; i < RUNTIME_TABLE_COUNT; i++)
+			fprintf(profile, "%s %"PRIu32"\n", runtime_table_names[i], capacity_high_water[i]);
+		fclose(profile);
+	}
+#endif // CAPACITY_PROFILE
+
+	while (slab_chunks) {
+		slab_chunk_t* next = slab_chunks->next;
+		free(slab_chunks);
+		slab_chunks = next;
+	}
 	for (uint_fast16_t i = 0; i < defined_sig_count; i++)
 		free_type_signature(&defined_signatures[i]);
 	free(heap_allocs);
 	free(heap_traces);
 	free(trace_frame_bounds);
-	free(freed_heap_allocs);
+	free(heap_remembered);
+	free(remembered_frame_bounds);
 	free(type_table);
 	free(defined_signatures);
 	free(ffi_table.func_table);
 	free(reset_stack);
+	free(mark_stack);
+#ifdef GROWABLE_STACK
+	free(stack);
+	free(positions);
+#ifdef CISH_DEBUG
+	free(src_loc_stack);
+#endif // CISH_DEBUG
+#endif // GROWABLE_STACK
+#ifdef INCREMENTAL_GC
+	free(heap_sweeps);
+	free(sweep_jobs);
+	free(frame_epochs);
+#endif // INCREMENTAL_GC
+#ifdef RUNTIME_STATS
+	free(ffi_call_counts);
+#endif // RUNTIME_STATS
+#ifdef RC_MODE
+	free(rc_buffer);
+#endif // RC_MODE
 
 #ifdef CISH_DEBUG
 	free(src_locs);
 #endif // CISH_DEBUG
+#ifdef HEAP_PROFILE
+	free(heap_sites);
+#endif // HEAP_PROFILE
 
 }
 
@@ -484,97 +1306,250 @@ static int type_signature_match(machine_type_sig_t match_signature, machine_type
 	return 1;
 }
 
-//traces a heap allocation permanatley - supertacing keeps heap alive in memory till the end of program
-static void supertrace(heap_alloc_t* heap_alloc) {
-	if (heap_alloc->gc_flag)
-		return;
+//flags a heap allocation as traced and pushes it onto the mark stack, traced heap allocs are also pushed onto a reset stack
+static inline int mark_alloc(heap_alloc_t* heap_alloc, int supertrace) {
+	if (!supertrace) {
+		if (reset_count == alloced_reset) {
+			heap_alloc_t** new_reset_stack = realloc(reset_stack, (alloced_reset *= 2) * sizeof(heap_alloc_t*));
+			PANIC_ON_FAIL(new_reset_stack, CISH_ERROR_MEMORY, 0);
+			reset_stack = new_reset_stack;
+		}
+		reset_stack[reset_count++] = heap_alloc;
+	}
 	heap_alloc->gc_flag = 1;
-	switch (heap_alloc->trace_mode) {
-	case GC_TRACE_MODE_ALL:
-		for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-			if (heap_alloc->init_stat[i])
-				supertrace(heap_alloc->registers[i].heap_alloc);
-		break;
-	case GC_TRACE_MODE_SOME:
-		for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-			if (heap_alloc->init_stat[i] && heap_alloc->trace_stat[i])
-				supertrace(heap_alloc->registers[i].heap_alloc);
-		break;
+#ifdef INCREMENTAL_GC
+	if (heap_alloc->gc_frame > heap_frame) { //survivors are re-registered in the parent frame as they're traced, because the frame's registrations are queued for sweeping
+		if (heap_count == alloced_heap_allocs) {
+			heap_alloc_t** new_heap_allocs = realloc(heap_allocs, (alloced_heap_allocs *= 2) * sizeof(heap_alloc_t*));
+			PANIC_ON_FAIL(new_heap_allocs, CISH_ERROR_MEMORY, 0);
+			heap_allocs = new_heap_allocs;
+		}
+		heap_allocs[heap_count++] = heap_alloc;
+		heap_alloc->gc_frame = heap_frame;
+		REGISTER_FRAME_EPOCH(heap_alloc);
+		HEAP_PROFILE_FLAG(heap_alloc, HEAP_SITE_SURVIVED, survived);
 	}
+#endif // INCREMENTAL_GC
+	if (supertrace)
+		HEAP_PROFILE_FLAG(heap_alloc, HEAP_SITE_SUPERTRACED, supertraced);
+#ifdef RUNTIME_STATS
+	if (supertrace)
+		runtime_stats.supertraced++;
+	else
+		runtime_stats.traced++;
+#endif // RUNTIME_STATS
+	return push_mark(heap_alloc);
 }
 
-//traces and pushes traced heap allocs onto a reset stack
-static int trace(heap_alloc_t* heap_alloc) {
-	if (heap_alloc->gc_flag)
+//marks every heap allocation reachable from root, using the mark stack rather than recursing
+//supertracing keeps heap alive in memory till the end of program
+static int mark(heap_alloc_t* root, int supertrace) {
+	if (root->gc_flag)
 		return 1;
 
-	if (reset_count == alloced_reset) {
-		heap_alloc_t** new_reset_stack = realloc(reset_stack, (alloced_reset += 32) * sizeof(heap_alloc_t*));
-		PANIC_ON_FAIL(new_reset_stack, CISH_ERROR_MEMORY, 0);
-		reset_stack = new_reset_stack;
+	mark_count = 0;
+	ESCAPE_ON_FAIL(mark_alloc(root, supertrace));
+	while (mark_count) {
+		heap_alloc_t* heap_alloc = mark_stack[--mark_count];
+		if (heap_alloc->trace_mode != GC_TRACE_MODE_NONE)
+			for (uint_fast32_t word = 0; word < STAT_WORDS(heap_alloc->limit); word++)
+				for (uint64_t children = traced_children(heap_alloc, word); children; children &= children - 1) {
+					heap_alloc_t* child = heap_alloc->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+					if (!child->gc_flag && (supertrace || child->gc_frame > heap_frame)) //old heap allocs outlive the frame being cleaned, and needn't be traced
+						ESCAPE_ON_FAIL(mark_alloc(child, supertrace));
+				}
 	}
+	return 1;
+}
 
-	heap_alloc->gc_flag = 1;
-	reset_stack[reset_count++] = heap_alloc;
+#define supertrace(HEAP_ALLOC) mark(HEAP_ALLOC, 1)
+#define trace(HEAP_ALLOC) mark(HEAP_ALLOC, 0)
 
-	switch (heap_alloc->trace_mode) {
-	case GC_TRACE_MODE_ALL:
-		for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-			if (heap_alloc->init_stat[i])
-				ESCAPE_ON_FAIL(trace(heap_alloc->registers[i].heap_alloc));
-		break;
-	case GC_TRACE_MODE_SOME:
-		for (uint_fast16_t i = 0; i < heap_alloc->limit; i++)
-			if (heap_alloc->init_stat[i] && heap_alloc->trace_stat[i])
-				ESCAPE_ON_FAIL(trace(heap_alloc->registers[i].heap_alloc));
-		break;
+#ifdef INCREMENTAL_GC
+//moves the registrations of a cleaned frame into the sweep queue, and closes the gap they leave in the heap table
+static int queue_sweep(uint32_t frame_start, uint32_t frame_end) {
+	uint32_t count = frame_end - frame_start;
+	if (!count)
+		return 1;
+
+	if (sweep_head == sweep_tail) {
+		sweep_head = sweep_tail = 0;
+		job_head = job_tail = 0;
+	}
+	else if (sweep_head > alloced_sweeps / 2) {
+		memmove(heap_sweeps, &heap_sweeps[sweep_head], (sweep_tail - sweep_head) * sizeof(heap_alloc_t*));
+		for (uint_fast32_t i = job_head; i < job_tail; i++)
+			sweep_jobs[i].end -= sweep_head;
+		sweep_tail -= sweep_head;
+		sweep_head = 0;
+	}
+	if (sweep_tail + count > alloced_sweeps) {
+		while (sweep_tail + count > alloced_sweeps)
+			alloced_sweeps *= 2;
+		heap_alloc_t** new_heap_sweeps = realloc(heap_sweeps, alloced_sweeps * sizeof(heap_alloc_t*));
+		ESCAPE_ON_FAIL(new_heap_sweeps);
+		heap_sweeps = new_heap_sweeps;
 	}
+	if (job_tail == alloced_jobs) {
+		if (job_head) {
+			memmove(sweep_jobs, &sweep_jobs[job_head], (job_tail - job_head) * sizeof(sweep_job_t));
+			job_tail -= job_head;
+			job_head = 0;
+		}
+		else {
+			sweep_job_t* new_sweep_jobs = realloc(sweep_jobs, (alloced_jobs *= 2) * sizeof(sweep_job_t));
+			ESCAPE_ON_FAIL(new_sweep_jobs);
+			sweep_jobs = new_sweep_jobs;
+		}
+	}
+
+	memcpy(&heap_sweeps[sweep_tail], &heap_allocs[frame_start], count * sizeof(heap_alloc_t*));
+	sweep_tail += count;
+	sweep_jobs[job_tail].end = sweep_tail;
+	sweep_jobs[job_tail++].epoch = frame_epochs[heap_frame + 1];
+
+	memmove(&heap_allocs[frame_start], &heap_allocs[frame_end], (heap_count - frame_end) * sizeof(heap_alloc_t*));
+	heap_count -= count;
 	return 1;
 }
 
+//sweeps queued registrations until the budget, in objects or microseconds, runs out
+static void gc_step(uint32_t budget) {
+	RUNTIME_STATS_COUNT(gc_steps);
+#ifdef GC_STEP_MICROS
+	uint64_t step_start = GC_STEP_CLOCK();
+#endif // GC_STEP_MICROS
+	for (uint_fast32_t swept = 0; sweep_head != sweep_tail; swept++) {
+#ifdef GC_STEP_MICROS
+		if (budget && !(swept % 64) && GC_STEP_CLOCK() - step_start >= budget)
+			break;
+#else
+		if (budget && swept == budget)
+			break;
+#endif // GC_STEP_MICROS
+		heap_alloc_t* heap_alloc = heap_sweeps[sweep_head++];
+		uint32_t epoch = sweep_jobs[job_head].epoch;
+		if (sweep_head == sweep_jobs[job_head].end)
+			job_head++;
+
+		if (heap_alloc->frame_epoch != epoch)
+			continue; //survived the clean, or was recycled and registered again
+		if (!heap_alloc->pre_freed) {
+			free_heap_alloc(heap_alloc);
+			heap_alloc->reg_with_table = 0;
+			recycle_heap_alloc(heap_alloc);
+		}
+		else
+			heap_alloc->reg_with_table = 0;
+	}
+}
+#endif // INCREMENTAL_GC
+
+//records an old heap allocation that's being written to by the current gc-frame
+static int remember_alloc(heap_alloc_t* heap_alloc) {
+	if (remembered_count == alloced_remembered) {
+		heap_alloc_t** new_remembered = realloc(heap_remembered, (alloced_remembered *= 2) * sizeof(heap_alloc_t*));
+		PANIC_ON_FAIL(new_remembered, CISH_ERROR_MEMORY, 0);
+		heap_remembered = new_remembered;
+	}
+	heap_remembered[remembered_count++] = heap_alloc;
+	heap_alloc->remembered_frame = heap_frame;
+	return 1;
+}
+
+#define GC_WRITE_BARRIER(HEAP_ALLOC, LAST_SRC_LOC) if ((HEAP_ALLOC)->gc_frame < heap_frame && (HEAP_ALLOC)->remembered_frame != heap_frame) PANIC_ON_FAIL(remember_alloc(HEAP_ALLOC), CISH_ERROR_MEMORY, LAST_SRC_LOC);
+
 //cleans the current gc-frame
 static int gc_clean() {
+#ifdef RUNTIME_STATS
+	clock_t clean_start = clock();
+	runtime_stats.gc_cleans++;
+	RUNTIME_STATS_PEAK(peak_heap_count, heap_count);
+#endif // RUNTIME_STATS
 	reset_count = 0;
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_HEAP_ALLOCS, heap_count);
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_HEAP_TRACES, trace_count);
+	CAPACITY_HIGH_WATER(RUNTIME_TABLE_REMEMBERED, remembered_count);
 
 	--heap_frame;
-	heap_alloc_t** frame_start = &heap_allocs[heap_frame_bounds[heap_frame]];
-	heap_alloc_t** frame_end = &heap_allocs[heap_count];
+	uint32_t frame_bound = heap_frame_bounds[heap_frame], frame_count = heap_count;
 
 	if (heap_frame) {
-		for (uint_fast16_t i = trace_frame_bounds[heap_frame]; i < trace_count; i++)
+		for (uint_fast32_t i = trace_frame_bounds[heap_frame]; i < trace_count; i++)
 			if (heap_traces[i]->gc_flag) {
 				heap_traces[i]->gc_flag = 0;
-				supertrace(heap_traces[i]);
+				ESCAPE_ON_FAIL(supertrace(heap_traces[i]));
 			}
 			else
 				ESCAPE_ON_FAIL(trace(heap_traces[i]));
 
+		//trace young heap allocs only reachable through remembered ones, and carry the remembered heap allocs that are still old over to the parent frame
+		uint32_t remembered_top = remembered_frame_bounds[heap_frame];
+		for (uint_fast32_t i = remembered_frame_bounds[heap_frame]; i < remembered_count; i++) {
+			heap_alloc_t* remembered = heap_remembered[i];
+			if (remembered->remembered_frame == heap_frame || remembered->pre_freed)
+				continue; //already carried over during this clean
+
+			if (remembered->trace_mode != GC_TRACE_MODE_NONE)
+				for (uint_fast32_t word = 0; word < STAT_WORDS(remembered->limit); word++)
+					for (uint64_t children = traced_children(remembered, word); children; children &= children - 1) {
+						heap_alloc_t* child = remembered->registers[word * 64 + __builtin_ctzll(children)].heap_alloc;
+						if (child->gc_frame > heap_frame)
+							ESCAPE_ON_FAIL(trace(child));
+					}
+			if (remembered->gc_frame < heap_frame) {
+				remembered->remembered_frame = heap_frame;
+				heap_remembered[remembered_top++] = remembered;
+			}
+			else
+				remembered->remembered_frame = UINT16_MAX; //it isn't old to the parent frame, so a later frame at this depth has to remember it again
+		}
+		remembered_count = remembered_top;
+		CAPACITY_HIGH_WATER(RUNTIME_TABLE_RESET_STACK, reset_count);
+
+#ifdef INCREMENTAL_GC
+		ESCAPE_ON_FAIL(queue_sweep(frame_bound, frame_count));
+		gc_step(GC_STEP_BUDGET);
+#else
+		heap_alloc_t** frame_start = &heap_allocs[frame_bound];
+		heap_alloc_t** frame_end = &heap_allocs[frame_count];
 		for (heap_alloc_t** current_alloc = frame_start; current_alloc != frame_end; current_alloc++) {
-			if ((*current_alloc)->gc_flag)
+			if ((*current_alloc)->gc_flag) {
+				(*current_alloc)->gc_frame = heap_frame; //survivors are promoted to the parent frame
+				HEAP_PROFILE_FLAG(*current_alloc, HEAP_SITE_SURVIVED, survived);
 				*frame_start++ = *current_alloc;
+			}
 			else if ((*current_alloc)->pre_freed)
 				(*current_alloc)->reg_with_table = 0;
 			else {
+#ifdef RC_MODE
+				ESCAPE_ON_FAIL(rc_release_survivors(*current_alloc));
+#endif // RC_MODE
 				free_heap_alloc(*current_alloc);
 				(*current_alloc)->reg_with_table = 0;
-				ESCAPE_ON_FAIL(recycle_heap_alloc(*current_alloc));
-				//free(*current_alloc);
+				recycle_heap_alloc(*current_alloc);
 			}
 		}
 		heap_count = frame_start - heap_allocs;
+#endif // INCREMENTAL_GC
 		trace_count = trace_frame_bounds[heap_frame];
-		for (uint_fast16_t i = 0; i < reset_count; i++)
+		for (uint_fast32_t i = 0; i < reset_count; i++)
 			reset_stack[i]->gc_flag = 0;
 	}
 	else {
-		for (heap_alloc_t** current_alloc = frame_start; current_alloc != frame_end; current_alloc++) {
-			if (!(*current_alloc)->pre_freed) {
+#ifdef INCREMENTAL_GC
+		gc_step(GC_SWEEP_ALL);
+#endif // INCREMENTAL_GC
+		for (heap_alloc_t** current_alloc = &heap_allocs[frame_bound]; current_alloc != &heap_allocs[frame_count]; current_alloc++) {
+			if (!(*current_alloc)->pre_freed)
 				free_heap_alloc(*current_alloc);
-				free(*current_alloc);
-			}
 		}
 		heap_count = 0;
+		remembered_count = 0;
 	}
+#ifdef RUNTIME_STATS
+	runtime_stats.gc_clean_clocks += clock() - clean_start;
+#endif // RUNTIME_STATS
 	return 1;
 }
 
@@ -593,7 +1568,7 @@ static int64_t longpow(int64_t base, int64_t exp) {
 }
 
 #define TRACE_COUNT_CHECK if (trace_count == alloced_trace_allocs) {\
-								heap_alloc_t** new_trace_stack = realloc(heap_traces, (alloced_trace_allocs += 10) * sizeof(heap_alloc_t*));\
+								heap_alloc_t** new_trace_stack = realloc(heap_traces, (alloced_trace_allocs *= 2) * sizeof(heap_alloc_t*));\
 								PANIC_ON_FAIL(new_trace_stack, CISH_ERROR_MEMORY, 0);\
 								heap_traces = new_trace_stack;\
 						  };
@@ -604,7 +1579,7 @@ static int64_t longpow(int64_t base, int64_t exp) {
 static char* heap_alloc_str(heap_alloc_t* heap_alloc) {
 	char* buffer = malloc(heap_alloc->limit + 1);
 	ESCAPE_ON_FAIL(buffer);
-	for (int i = 0; i < heap_alloc->limit; i++)
+	for (uint_fast32_t i = 0; i < heap_alloc->limit; i++)
 		buffer[i] = heap_alloc->registers[i].char_int;
 	buffer[heap_alloc->limit] = 0;
 	return buffer;
@@ -637,7 +1612,7 @@ static int std_ftos(machine_reg_t* in, machine_reg_t* out) {
 	out->heap_alloc = alloc(len, GC_TRACE_MODE_NONE);
 	for (uint_fast8_t i = 0; i < len; i++) {
 		out->heap_alloc->registers[i].char_int = output[i];
-		out->heap_alloc->init_stat[i] = 1;
+		STAT_SET(out->heap_alloc->init_stat, i);
 	}
 	return 1;
 }
@@ -658,7 +1633,7 @@ static int std_itos(machine_reg_t* in, machine_reg_t* out) {
 	ESCAPE_ON_FAIL(out->heap_alloc = alloc(len, GC_TRACE_MODE_NONE));
 	for (uint_fast8_t i = 0; i < len; i++) {
 		out->heap_alloc->registers[i].char_int = output[i];
-		out->heap_alloc->init_stat[i] = 1;
+		STAT_SET(out->heap_alloc->init_stat, i);
 	}
 	return 1;
 }
@@ -751,14 +1726,32 @@ static int std_sleep(machine_reg_t* in, machine_reg_t* out) {
 static int std_realloc(machine_reg_t* in, machine_reg_t* out) {
 	heap_alloc_t* alloc = out->heap_alloc;
 
-	if (alloc->trace_mode == GC_TRACE_MODE_SOME || alloc->limit > UINT16_MAX - in->long_int)
-		PANIC(CISH_ERROR_INTERNAL, 0); //cannot realloc non array object nor go above uint16 length limit
+	if (alloc->trace_mode == GC_TRACE_MODE_SOME || alloc->limit > UINT32_MAX - in->long_int)
+		PANIC(CISH_ERROR_INTERNAL, 0); //cannot realloc non array object nor go above uint32 length limit
 
-	PANIC_ON_FAIL(alloc->registers = realloc(alloc->registers, (alloc->limit + in->long_int) * sizeof(machine_reg_t)), CISH_ERROR_MEMORY, 0);
-	PANIC_ON_FAIL(alloc->init_stat = realloc(alloc->init_stat, (alloc->limit + in->long_int) * sizeof(int)), CISH_ERROR_MEMORY, 0);
-	memset(&alloc->init_stat[alloc->limit], 0, in->long_int * sizeof(int));
+	uint32_t new_limit = alloc->limit + in->long_int;
+	if (alloc->detached) {
+		PANIC_ON_FAIL(alloc->registers = realloc(alloc->registers, new_limit * sizeof(machine_reg_t)), CISH_ERROR_MEMORY, 0);
+		PANIC_ON_FAIL(alloc->init_stat = realloc(alloc->init_stat, STAT_WORDS(new_limit) * sizeof(uint64_t)), CISH_ERROR_MEMORY, 0);
+	}
+	else if (new_limit > SLAB_CAPACITY(alloc->size_class)) { //outgrew its block, move registers into a detached buffer
+		machine_reg_t* registers = malloc(new_limit * sizeof(machine_reg_t));
+		uint64_t* init_stat = calloc(STAT_WORDS(new_limit), sizeof(uint64_t));
+		if (!registers || !init_stat) {
+			free(registers);
+			free(init_stat);
+			PANIC(CISH_ERROR_MEMORY, 0);
+		}
+		memcpy(registers, alloc->registers, alloc->limit * sizeof(machine_reg_t));
+		memcpy(init_stat, alloc->init_stat, STAT_WORDS(alloc->limit) * sizeof(uint64_t));
+		alloc->registers = registers;
+		alloc->init_stat = init_stat;
+		alloc->detached = 1;
+	}
+	//status words past the old limit may be uninitialized or stale from a recycled block
+	memset(&alloc->init_stat[STAT_WORDS(alloc->limit)], 0, (STAT_WORDS(new_limit) - STAT_WORDS(alloc->limit)) * sizeof(uint64_t));
 
-	alloc->limit += in->long_int;
+	alloc->limit = new_limit;
 
 	return 1;
 }